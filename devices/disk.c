@@ -59,6 +59,8 @@ struct disk {
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
+	long long read_cmd_cnt;     /* Number of READ SECTORS commands. */
+	long long write_cmd_cnt;    /* Number of WRITE SECTORS commands. */
 };
 
 /* An ATA channel (aka controller).
@@ -84,7 +86,7 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -119,7 +121,7 @@ disk_init (void) {
 			default:
 				NOT_REACHED ();
 		}
-		lock_init (&c->lock);
+		lock_init_named (&c->lock, c->name);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
 
@@ -134,6 +136,7 @@ disk_init (void) {
 			d->capacity = 0;
 
 			d->read_cnt = d->write_cnt = 0;
+			d->read_cmd_cnt = d->write_cmd_cnt = 0;
 		}
 
 		/* Register interrupt handler. */
@@ -167,8 +170,10 @@ disk_print_stats (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++) {
 			struct disk *d = disk_get (chan_no, dev_no);
 			if (d != NULL && d->is_ata)
-				printf ("%s: %lld reads, %lld writes\n",
-						d->name, d->read_cnt, d->write_cnt);
+				printf ("%s: %lld reads, %lld writes "
+						"(%lld read commands, %lld write commands)\n",
+						d->name, d->read_cnt, d->write_cnt,
+						d->read_cmd_cnt, d->write_cmd_cnt);
 		}
 	}
 }
@@ -209,47 +214,104 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
+	disk_read_multiple (d, sec_no, buffer, 1);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   DISK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
+	disk_write_multiple (d, sec_no, buffer, 1);
+}
+
+/* Reads CNT consecutive sectors starting at SEC_NO from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  Each run of up to DISK_MAX_SECTORS sectors is
+   transferred by a single READ SECTORS command, which saves the
+   device selection and command setup per sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, void *buffer,
+		size_t cnt) {
 	struct channel *c;
+	uint8_t *p = buffer;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	while (cnt > 0) {
+		size_t n = cnt < DISK_MAX_SECTORS ? cnt : DISK_MAX_SECTORS;
+		size_t i;
+
+		lock_acquire (&c->lock);
+		select_sector (d, sec_no, n);
+		issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+		for (i = 0; i < n; i++) {
+			/* The device interrupts once per sector it has ready. */
+			sema_down (&c->completion_wait);
+			if (!wait_while_busy (d))
+				PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name,
+						sec_no + (disk_sector_t) i);
+			input_sector (c, p + i * DISK_SECTOR_SIZE);
+		}
+		d->read_cnt += n;
+		d->read_cmd_cnt++;
+		lock_release (&c->lock);
+
+		sec_no += n;
+		p += n * DISK_SECTOR_SIZE;
+		cnt -= n;
+	}
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   DISK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT consecutive sectors starting at SEC_NO to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes.
+   Returns after the disk has acknowledged receiving the data.
+   Each run of up to DISK_MAX_SECTORS sectors is transferred by a
+   single WRITE SECTORS command.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 void
-disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
+disk_write_multiple (struct disk *d, disk_sector_t sec_no,
+		const void *buffer, size_t cnt) {
 	struct channel *c;
+	const uint8_t *p = buffer;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
-	lock_release (&c->lock);
+	while (cnt > 0) {
+		size_t n = cnt < DISK_MAX_SECTORS ? cnt : DISK_MAX_SECTORS;
+		size_t i;
+
+		lock_acquire (&c->lock);
+		select_sector (d, sec_no, n);
+		issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+		for (i = 0; i < n; i++) {
+			/* The device asks for each sector with DRQ and interrupts
+			   once it has taken it. */
+			if (!wait_while_busy (d))
+				PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name,
+						sec_no + (disk_sector_t) i);
+			output_sector (c, p + i * DISK_SECTOR_SIZE);
+			sema_down (&c->completion_wait);
+		}
+		d->write_cnt += n;
+		d->write_cmd_cnt++;
+		lock_release (&c->lock);
+
+		sec_no += n;
+		p += n * DISK_SECTOR_SIZE;
+		cnt -= n;
+	}
 }
-
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -402,17 +464,18 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt >= 1 && cnt <= DISK_MAX_SECTORS);
+	ASSERT (sec_no + cnt <= d->capacity);
+	ASSERT (sec_no + cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt == DISK_MAX_SECTORS ? 0 : cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -8,6 +8,7 @@
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/fixed-point.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -21,14 +22,120 @@
 /* Number of timer ticks since OS booted. */
 static int64_t os_ticks;
 
+/* 계층적 타이머 휠.
+ * tv1은 앞으로 TVR_SIZE 틱 안에 만료되는 타이머를 틱 단위 슬롯에 보관하고,
+ * tvn[level]은 그보다 먼 타이머를 TVN_SIZE개의 점점 거친 슬롯에 보관한다.
+ * tv1이 한 바퀴 돌 때마다 상위 레벨의 슬롯 하나를 하위 레벨로 내려보낸다(cascade).
+ * 따라서 삽입과 취소는 O(1)이고, 매 틱의 비용은 만료된 타이머 수에 비례한다. */
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 4
+
+/* tvn[LEVEL]이 담을 수 있는 최대 거리(틱), 그리고 tvn[LEVEL]의 슬롯 인덱스 시프트. */
+#define TVN_LIMIT(LEVEL) (1LL << (TVR_BITS + ((LEVEL) + 1) * TVN_BITS))
+#define TVN_SHIFT(LEVEL) (TVR_BITS + (LEVEL) * TVN_BITS)
+
+static struct list tv1[TVR_SIZE];
+static struct list tvn[TVN_LEVELS][TVN_SIZE];
+
+/* 타이머 휠이 아직 처리하지 않은 가장 이른 틱. */
+static int64_t wheel_ticks;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* TSC 기반 고해상도 시계.
+ * tsc_base는 timer_init() 시점의 TSC 값이고, tsc_hz는 timer_calibrate()에서 PIT로 측정한 TSC 주파수이다.
+ * TSC 사이클은 ns_mult / 2^32를 곱해 나노초로 바꾼다. */
+static uint64_t tsc_base;
+static uint64_t tsc_hz;
+static uint64_t ns_mult;
+
+/* 마지막 틱 경계의 TSC 값. hr_sleep()이 다음 틱 경계들의 시각을 계산하는 데 쓴다. */
+static uint64_t tick_tsc;
+
+/* TSC 보정에 사용할 틱 수. */
+#define TSC_CALIBRATE_TICKS 5
+
+/* 한 틱의 길이(ns). */
+#define NS_PER_TICK (1000000000LL / TIMER_FREQ)
+
+/* 8254의 입력 클럭(Hz)과 한 틱에 해당하는 카운트. */
+#define PIT_HZ 1193180
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* PIT가 실제로 만드는 한 틱의 길이(ns). 카운트를 반올림했으므로 NS_PER_TICK과 조금 다르다. */
+#define PIT_TICK_NS (PIT_TICK_COUNT * 1000000000LL / PIT_HZ)
+
+/* 한 번 틱을 멈출 때 건너뛸 수 있는 최대 틱 수. wheel_idle_ticks()가 훑는 범위를 제한한다. */
+#define NOHZ_MAX_TICKS (TIMER_FREQ * 10)
+
+/* one-shot 한 구간의 최대 카운트(약 55ms). 카운터는 16비트이므로 더 긴 시간은 여러 구간을 이어서 센다. */
+#define PIT_ONESHOT_MAX 0xffff
+
+/* hr_sleep()이 깨어난 뒤 busy-wait로 채우는 시간(ns). 인터럽트 지연과 PIT/TSC 사이의 오차를 흡수한다. */
+#define HR_SLACK_NS (10 * 1000)
+
+/* 틱 경계까지 남은 카운트가 이보다 적다면 one-shot을 설정하지 않고 곧 들어올 틱 인터럽트에 맡긴다. */
+#define HR_ARM_MIN_COUNT 16
+
+/* -o nohz: Idle 상태에서 주기적인 타이머 인터럽트를 멈추는가? */
+bool timer_nohz;
+
+/* Dynamic tick 상태.
+ * oneshot_ticks가 0이 아니라면 PIT가 one-shot 모드로 oneshot_count만큼 세고 있고,
+ * 그 뒤로 oneshot_left만큼을 더 센 다음 인터럽트가 발생하면 oneshot_ticks개의 틱이 지난 것이다.
+ * oneshot_elapsed는 이번에 틱을 멈춘 뒤 끝난 구간들의 카운트 합이다.
+ * tick_stopped는 Idle 스레드가 틱을 멈추고 잠든 상태인지를 나타낸다.
+ * nohz_wake는 틱이 멈춘 동안 다른 인터럽트가 들어왔지만 구간이 이미 끝나 있어서,
+ * 틱을 되살리는 일을 곧 들어올 타이머 인터럽트에 맡겼음을 나타낸다. */
+static int64_t oneshot_ticks;
+static uint16_t oneshot_count;
+static int64_t oneshot_left;
+static int64_t oneshot_elapsed;
+static bool tick_stopped;
+static bool nohz_wake;
+
+/* hr_sleep()으로 한 틱 안의 시각까지 잠든 스레드. */
+struct hr_sleeper
+{
+	struct list_elem elem;
+	int64_t wake;		   /* 깨어날 시각(ns). */
+	struct thread *thread; /* 잠든 스레드. */
+};
+
+/* 깨어날 시각 순으로 정렬된 hr_sleeper 리스트. 인터럽트를 끄고 다룬다. */
+static struct list hr_list;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
+static void hr_sleep(int64_t ns);
+static int64_t tsc_to_ns(uint64_t tsc);
+static void tsc_calibrate(void);
+static void wheel_insert(struct timer *timer);
+static void wheel_cascade(int level, int index);
+static void wheel_run(void);
+static int64_t wheel_idle_ticks(int64_t limit);
+static bool wheel_cascade_pending(int64_t tick);
+static void timer_do_tick(void);
+static void nohz_exit(int64_t elapsed);
+static void hr_block(int64_t wake);
+static bool hr_less(const struct list_elem *a, const struct list_elem *b, void *aux);
+static void hr_run(void);
+static void hr_arm(void);
+static int64_t hr_pit_count(int64_t wake);
+static void pit_program(uint8_t mode, uint16_t count);
+static void pit_oneshot_next(void);
+static uint16_t pit_read(void);
+static bool pit_irq_pending(void);
+static bool pit_segment_done(uint16_t remaining);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
@@ -37,11 +144,15 @@ void timer_init(void)
 {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_program(0x34, PIT_TICK_COUNT); /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	tsc_base = rdtsc();
 
-	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb(0x40, count & 0xff);
-	outb(0x40, count >> 8);
+	for (int i = 0; i < TVR_SIZE; i++)
+		list_init(&tv1[i]);
+	for (int level = 0; level < TVN_LEVELS; level++)
+		for (int i = 0; i < TVN_SIZE; i++)
+			list_init(&tvn[level][i]);
+	list_init(&hr_list);
 
 	intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
@@ -70,6 +181,34 @@ void timer_calibrate(void)
 			loops_per_tick |= test_bit;
 
 	printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+
+	tsc_calibrate();
+}
+
+/* tsc_calibrate - TSC_CALIBRATE_TICKS 틱 동안 증가한 TSC 값으로 TSC 주파수를 구한다.
+ */
+static void tsc_calibrate(void)
+{
+	int64_t start;
+	uint64_t tsc_start, tsc_end;
+
+	ASSERT(intr_get_level() == INTR_ON);
+	printf("Calibrating TSC...  ");
+
+	/* Wait for a timer tick. */
+	start = os_ticks;
+	while (os_ticks == start)
+		barrier();
+
+	start = os_ticks;
+	tsc_start = rdtsc();
+	while (os_ticks < start + TSC_CALIBRATE_TICKS)
+		barrier();
+	tsc_end = rdtsc();
+
+	tsc_hz = (tsc_end - tsc_start) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+	ns_mult = (1000000000ULL << 32) / tsc_hz;
+	printf("%'" PRIu64 " Hz.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -89,30 +228,112 @@ int64_t timer_elapsed(int64_t then)
 	return timer_ticks() - then;
 }
 
-/* timer_sleep() - 현재 스레드를 ticks만큼 BLOCKED 상태로 만들고, wakeup_tick 내림차순으로 sleep_list에 삽입한다.
+/* timer_sleep() - 현재 스레드를 ticks만큼 BLOCKED 상태로 만든다.
+ * ticks가 0 이하라면 바로 반환한다.
  */
 void timer_sleep(int64_t ticks)
 {
 	ASSERT(intr_get_level() == INTR_ON);
+	if (ticks <= 0)
+		return;
 	thread_sleep(timer_ticks() + ticks);
 }
 
+/* timer_ns - 부팅 이후 지난 시간을 나노초 단위로 반환한다.
+ * TSC를 읽으므로 틱보다 훨씬 정밀하며, 인터럽트 핸들러에서도 호출할 수 있다.
+ * TSC 보정이 끝나기 전에는 틱 단위의 값을 반환한다.
+ */
+int64_t timer_ns(void)
+{
+	if (tsc_hz == 0)
+		return timer_ticks() * NS_PER_TICK;
+	return tsc_to_ns(rdtsc());
+}
+
+/* tsc_to_ns - TSC 값 TSC를 부팅 이후의 나노초로 바꾼다. */
+static int64_t tsc_to_ns(uint64_t tsc)
+{
+	return ((unsigned __int128)(tsc - tsc_base) * ns_mult) >> 32;
+}
+
 /* Suspends execution for approximately MS milliseconds. */
 void timer_msleep(int64_t ms)
 {
-	real_time_sleep(ms, 1000);
+	hr_sleep(ms * 1000 * 1000);
 }
 
 /* Suspends execution for approximately US microseconds. */
 void timer_usleep(int64_t us)
 {
-	real_time_sleep(us, 1000 * 1000);
+	hr_sleep(us * 1000);
 }
 
 /* Suspends execution for approximately NS nanoseconds. */
 void timer_nsleep(int64_t ns)
 {
-	real_time_sleep(ns, 1000 * 1000 * 1000);
+	hr_sleep(ns);
+}
+
+/* timer_setup - 타이머를 FUNC(AUX)를 호출하는 등록되지 않은 타이머로 초기화한다.
+ */
+void timer_setup(struct timer *timer, timer_func *func, void *aux)
+{
+	ASSERT(timer != NULL);
+	ASSERT(func != NULL);
+
+	timer->func = func;
+	timer->aux = aux;
+	timer->expires = 0;
+	timer->pending = false;
+}
+
+/* timer_add - 타이머가 EXPIRES 틱에 만료되도록 타이머 휠에 등록한다.
+ * EXPIRES가 이미 지났다면 다음 틱에 만료된다. 이미 등록된 타이머라면 만료 시각을 바꾼다.
+ * 이 함수는 인터럽트 핸들러(타이머 콜백 포함)에서 호출될 수 있다.
+ */
+void timer_add(struct timer *timer, int64_t expires)
+{
+	enum intr_level old_level;
+
+	ASSERT(timer != NULL);
+	ASSERT(timer->func != NULL);
+
+	old_level = intr_disable();
+	if (timer->pending)
+		list_remove(&timer->elem);
+	timer->expires = expires;
+	timer->pending = true;
+	wheel_insert(timer);
+	intr_set_level(old_level);
+}
+
+/* timer_cancel - 등록된 타이머를 타이머 휠에서 제거한다.
+ * 타이머가 만료되기 전에 제거되었다면 true, 등록되어 있지 않았다면 false를 반환한다.
+ */
+bool timer_cancel(struct timer *timer)
+{
+	enum intr_level old_level;
+	bool pending;
+
+	ASSERT(timer != NULL);
+
+	old_level = intr_disable();
+	pending = timer->pending;
+	if (pending)
+	{
+		list_remove(&timer->elem);
+		timer->pending = false;
+	}
+	intr_set_level(old_level);
+	return pending;
+}
+
+/* timer_pending - 타이머가 등록되어 아직 만료되지 않았다면 true를 반환한다.
+ */
+bool timer_pending(const struct timer *timer)
+{
+	ASSERT(timer != NULL);
+	return timer->pending;
 }
 
 /* Prints timer statistics. */
@@ -121,26 +342,308 @@ void timer_print_stats(void)
 	printf("Timer: %" PRId64 " ticks\n", timer_ticks());
 }
 
+/* timer_idle_enter - Idle 스레드가 hlt 하기 직전에 인터럽트가 꺼진 상태로 호출한다.
+ * -o nohz 옵션이 켜져 있다면, 가장 가까운 타이머의 만료 시각까지(최대 NOHZ_MAX_TICKS 틱)
+ * 타이머 인터럽트가 발생하지 않도록 PIT를 one-shot 모드로 다시 설정한다.
+ * hr_sleep()으로 잠든 스레드가 있다면 그 스레드가 깨어날 시각 전의 틱 경계까지만 멈춘다.
+ * 16비트 카운터로 셀 수 없는 긴 시간은 PIT_ONESHOT_MAX 단위의 구간으로 나누어 이어서 센다.
+ * 건너뛴 틱은 다음 인터럽트가 들어올 때 timer_irq_enter()에서 한꺼번에 반영한다.
+ */
+void timer_idle_enter(void)
+{
+	int64_t ticks;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (!timer_nohz || oneshot_ticks != 0)
+		return;
+
+	ticks = wheel_idle_ticks(NOHZ_MAX_TICKS);
+	if (!list_empty(&hr_list))
+	{
+		int64_t wake = list_entry(list_front(&hr_list), struct hr_sleeper, elem)->wake;
+		int64_t hr_ticks = (wake - timer_ns()) / PIT_TICK_NS;
+		if (hr_ticks < ticks)
+			ticks = hr_ticks;
+	}
+	if (ticks <= 1)
+		return;
+
+	oneshot_ticks = ticks;
+	oneshot_left = ticks * PIT_TICK_COUNT;
+	oneshot_elapsed = 0;
+	tick_stopped = true;
+	pit_oneshot_next();
+}
+
+/* timer_irq_enter - 외부 인터럽트 핸들러가 실행되기 전에 intr_handler()에서 호출된다.
+ * 타이머 인터럽트라면 먼저 깨어날 시각이 된 hr_sleep() 스레드들을 깨운다.
+ * 그리고 틱이 멈춰 있던 동안 지나간 틱을 os_ticks와 통계, 타이머 휠에 반영하고 주기적인 틱으로 되돌린다.
+ *
+ * one-shot 타이머 인터럽트라면 마지막 틱은 timer_interrupt()가 처리하므로 나머지 틱만 반영한다.
+ * 아직 셀 구간이 남아 있다면 다음 구간을 설정할 뿐이고, timer_interrupt()도 틱을 처리하지 않는다.
+ * 다른 장치의 인터럽트로 일찍 깨어났다면 nohz_exit()으로 틱을 되살린다.
+ */
+void timer_irq_enter(uint8_t vec_no)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (vec_no == 0x20)
+		hr_run();
+	if (oneshot_ticks == 0)
+		return;
+
+	if (vec_no == 0x20)
+	{
+		if (oneshot_left > 0)
+		{
+			oneshot_elapsed += oneshot_count;
+			if (nohz_wake)
+				nohz_exit(oneshot_elapsed);
+			else
+				pit_oneshot_next();
+			return;
+		}
+		for (int64_t i = 1; i < oneshot_ticks; i++)
+			timer_do_tick();
+		oneshot_ticks = 0;
+		tick_stopped = false;
+		nohz_wake = false;
+		pit_program(0x34, PIT_TICK_COUNT);
+	}
+	else if (tick_stopped && !nohz_wake)
+	{
+		uint16_t remaining = pit_read();
+
+		/* 구간이 이미 끝났다면 IRQ0가 기다리고 있으므로 그 인터럽트에서 틱을 되살린다.
+		   지금 one-shot을 다시 설정하면 기다리던 IRQ0가 그 구간을 끝낸 것으로 처리되어 틱이 두 번 반영된다. */
+		if (pit_segment_done(remaining))
+		{
+			nohz_wake = true;
+			return;
+		}
+		nohz_exit(oneshot_elapsed + oneshot_count - remaining);
+	}
+}
+
+/* nohz_exit - 틱을 멈춘 뒤 PIT 카운트로 ELAPSED만큼 지났을 때 틱을 되살린다.
+ * 완전히 지난 틱만 반영하고, 틱의 위상을 유지하도록 현재 틱의 남은 시간만큼 one-shot을 다시 설정한다.
+ */
+static void nohz_exit(int64_t elapsed)
+{
+	int64_t whole = elapsed / PIT_TICK_COUNT;
+	int64_t partial = elapsed % PIT_TICK_COUNT;
+
+	for (int64_t i = 0; i < whole; i++)
+		timer_do_tick();
+	tick_tsc = rdtsc() - (uint64_t)partial * tsc_hz / PIT_HZ;
+
+	oneshot_ticks = 1;
+	oneshot_left = PIT_TICK_COUNT - partial;
+	oneshot_elapsed = 0;
+	tick_stopped = false;
+	nohz_wake = false;
+	pit_oneshot_next();
+}
+
 /* timer_interrupt() - 타이머 인터럽트 핸들러. 10ms당 한 번씩 호출. 1초에 100번 호출
+ * 틱이 멈춰 있는 동안 one-shot 구간 사이에 들어온 인터럽트는 틱이 아니므로 무시한다.
  */
 static void timer_interrupt(struct intr_frame *args UNUSED)
+{
+	if (oneshot_ticks != 0)
+		return;
+	tick_tsc = rdtsc();
+	timer_do_tick();
+	hr_arm();
+}
+
+/* timer_do_tick - 한 틱을 처리한다. os_ticks를 증가시키고, 스레드 통계와 만료된 타이머,
+ * 고급 스케줄러의 주기적인 계산을 수행한다.
+ */
+static void timer_do_tick(void)
 {
 	os_ticks++;
 	thread_tick();
-	thread_wakeup(os_ticks);
+	wheel_run();
 
 	if (!thread_mlfqs)
 		return;
 
 	if (timer_ticks() % TIMER_FREQ == 0) {
 		calculate_load_avg();
-		calculate_all_recent_cpu();
+		calculate_recent_cpu_decay();
 	}
 	if (timer_ticks() % 4 == 0)
-		calculate_all_priority();
+		calculate_current_priority();
 	recent_cpu_plus();
 }
 
+/* wheel_insert - 타이머를 만료 시각까지의 거리에 맞는 휠 슬롯에 넣는다.
+ * 가장 상위 레벨로도 담을 수 없을 만큼 먼 타이머는 가장 먼 슬롯에 넣고, cascade될 때 다시 자리를 찾는다.
+ */
+static void wheel_insert(struct timer *timer)
+{
+	int64_t expires = timer->expires;
+	int64_t delta = expires - wheel_ticks;
+	struct list *slot;
+
+	if (delta < 0)
+		slot = &tv1[wheel_ticks & TVR_MASK];
+	else if (delta < TVR_SIZE)
+		slot = &tv1[expires & TVR_MASK];
+	else
+	{
+		int level = 0;
+		while (level < TVN_LEVELS - 1 && delta >= TVN_LIMIT(level))
+			level++;
+		if (delta >= TVN_LIMIT(level))
+			expires = wheel_ticks + TVN_LIMIT(level) - 1;
+		slot = &tvn[level][(expires >> TVN_SHIFT(level)) & TVN_MASK];
+	}
+	list_push_back(slot, &timer->elem);
+}
+
+/* wheel_cascade - tvn[level][index] 슬롯의 타이머를 모두 꺼내어 하위 레벨에 다시 넣는다.
+ */
+static void wheel_cascade(int level, int index)
+{
+	struct list pending;
+
+	list_init(&pending);
+	list_splice(list_end(&pending), list_begin(&tvn[level][index]), list_end(&tvn[level][index]));
+	while (!list_empty(&pending))
+		wheel_insert(list_entry(list_pop_front(&pending), struct timer, elem));
+}
+
+/* wheel_run - 현재 틱까지 만료된 타이머의 콜백을 호출한다.
+ * 타이머 인터럽트 핸들러에서 호출된다.
+ */
+static void wheel_run(void)
+{
+	struct list expired;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (wheel_ticks <= os_ticks)
+	{
+		int index = wheel_ticks & TVR_MASK;
+
+		/* tv1이 한 바퀴를 돌았다면 상위 레벨에서 다음 구간의 타이머를 내려받는다. */
+		if (index == 0)
+			for (int level = 0; level < TVN_LEVELS; level++)
+			{
+				int i = (wheel_ticks >> TVN_SHIFT(level)) & TVN_MASK;
+				wheel_cascade(level, i);
+				if (i != 0)
+					break;
+			}
+
+		/* 콜백이 같은 슬롯에 타이머를 다시 넣을 수 있으므로 먼저 슬롯을 비운다. */
+		list_init(&expired);
+		list_splice(list_end(&expired), list_begin(&tv1[index]), list_end(&tv1[index]));
+		wheel_ticks++;
+
+		while (!list_empty(&expired))
+		{
+			struct timer *timer = list_entry(list_pop_front(&expired), struct timer, elem);
+			timer->pending = false;
+			timer->func(timer->aux);
+		}
+	}
+}
+
+/* wheel_idle_ticks - 만료되는 타이머 없이 건너뛸 수 있는 틱 수를 LIMIT 이하로 반환한다.
+ * 반환값을 N이라 하면 os_ticks + 1 ~ os_ticks + N - 1 틱에는 만료되는 타이머가 없다.
+ * tv1이 한 바퀴를 도는 틱에는 상위 레벨에서 내려올 타이머가 있을 때만 멈춘다.
+ * 내려올 타이머가 없다면 다음 구간의 타이머는 모두 이미 tv1에 있다.
+ */
+static int64_t wheel_idle_ticks(int64_t limit)
+{
+	int64_t ticks;
+
+	for (ticks = 1; ticks < limit; ticks++)
+	{
+		int64_t tick = os_ticks + ticks;
+		if (!list_empty(&tv1[tick & TVR_MASK]))
+			break;
+		if ((tick & TVR_MASK) == 0 && wheel_cascade_pending(tick))
+			break;
+	}
+	return ticks;
+}
+
+/* wheel_cascade_pending - TICK에서 wheel_run()이 cascade할 상위 레벨 슬롯에 타이머가 있다면 true를 반환한다.
+ */
+static bool wheel_cascade_pending(int64_t tick)
+{
+	for (int level = 0; level < TVN_LEVELS; level++)
+	{
+		int i = (tick >> TVN_SHIFT(level)) & TVN_MASK;
+		if (!list_empty(&tvn[level][i]))
+			return true;
+		if (i != 0)
+			break;
+	}
+	return false;
+}
+
+/* pit_program - PIT 카운터 0을 제어 워드 MODE와 초기값 COUNT로 설정한다.
+ */
+static void pit_program(uint8_t mode, uint16_t count)
+{
+	outb(0x43, mode);
+	outb(0x40, count & 0xff);
+	outb(0x40, count >> 8);
+}
+
+/* pit_oneshot_next - oneshot_left에서 PIT_ONESHOT_MAX 이하의 다음 구간을 떼어 one-shot으로 센다.
+ * 틱이 흐르는 동안에는 가장 먼저 깨어날 hr_sleep() 스레드의 시각에서 구간을 끊는다.
+ */
+static void pit_oneshot_next(void)
+{
+	int64_t count = oneshot_left < PIT_ONESHOT_MAX ? oneshot_left : PIT_ONESHOT_MAX;
+
+	if (!tick_stopped && !list_empty(&hr_list))
+	{
+		int64_t hr_count = hr_pit_count(list_entry(list_front(&hr_list), struct hr_sleeper, elem)->wake);
+		if (hr_count < count)
+			count = hr_count;
+	}
+	oneshot_count = count;
+	oneshot_left -= count;
+	pit_program(0x30, oneshot_count); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+}
+
+/* pit_read - PIT 카운터 0의 현재 값을 래치하여 읽는다.
+ */
+static uint16_t pit_read(void)
+{
+	uint8_t lo, hi;
+
+	outb(0x43, 0x00); /* CW: counter 0, latch. */
+	lo = inb(0x40);
+	hi = inb(0x40);
+	return lo | (hi << 8);
+}
+
+/* pit_irq_pending - PIC가 받아 둔 IRQ0(타이머)를 아직 CPU에 전달하지 않았다면 true를 반환한다.
+ */
+static bool pit_irq_pending(void)
+{
+	outb(0x20, 0x0a); /* OCW3: read IRR. */
+	return inb(0x20) & 0x01;
+}
+
+/* pit_segment_done - 카운터 값 REMAINING으로 보아 진행 중인 one-shot 구간이 이미 끝났다면 true를 반환한다.
+ * mode 0 카운터는 0에 도달한 뒤에도 0xffff부터 계속 줄어들므로, 구간보다 큰 값도 끝난 것이다.
+ * 구간이 끝났다면 IRQ0가 기다리고 있거나 곧 들어온다.
+ */
+static bool pit_segment_done(uint16_t remaining)
+{
+	return remaining == 0 || remaining > oneshot_count || pit_irq_pending();
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool too_many_loops(unsigned loops)
@@ -172,6 +675,148 @@ static void NO_INLINE busy_wait(int64_t loops)
 		barrier();
 }
 
+/* hr_sleep - NS 나노초 동안 정밀하게 잠든다.
+ * 끝나는 시각보다 HR_SLACK_NS 이른 시각(wake)까지 BLOCKED 상태로 보내어 CPU를 양보하고,
+ * 나머지 HR_SLACK_NS만 TSC를 보며 busy-wait한다.
+ * wake 이전의 마지막 틱 경계까지는 thread_sleep()으로 타이머 휠에서 잠들고,
+ * 그 경계부터 wake까지 남은 한 틱 미만의 시간은 hr_block()으로 PIT one-shot 인터럽트를 기다린다.
+ * 틱 경계의 시각은 마지막 틱의 TSC 값(tick_tsc)에서 계산한다.
+ * TSC 보정 전에는 real_time_sleep()을 사용한다.
+ */
+static void hr_sleep(int64_t ns)
+{
+	enum intr_level old_level;
+	int64_t deadline, wake, last_tick, tick_start, ticks;
+
+	ASSERT(intr_get_level() == INTR_ON);
+
+	if (ns <= 0)
+		return;
+	if (tsc_hz == 0)
+	{
+		real_time_sleep(ns, 1000 * 1000 * 1000);
+		return;
+	}
+
+	deadline = timer_ns() + ns;
+	wake = deadline - HR_SLACK_NS;
+
+	old_level = intr_disable();
+	last_tick = os_ticks;
+	tick_start = tsc_to_ns(tick_tsc);
+	intr_set_level(old_level);
+
+	/* last_tick + TICKS 틱의 경계가 wake를 넘지 않는 가장 큰 TICKS. */
+	ticks = (wake - tick_start) / PIT_TICK_NS;
+	if (ticks > 0)
+		thread_sleep(last_tick + ticks);
+	if (timer_ns() < wake)
+		hr_block(wake);
+
+	while (timer_ns() < deadline)
+		asm volatile("pause" : : : "memory");
+}
+
+/* hr_block - 현재 스레드를 WAKE(ns)까지 BLOCKED 상태로 만든다.
+ * WAKE는 한 틱 안쪽이어야 효율적이다. 그보다 멀다면 WAKE가 든 틱이 시작될 때 PIT가 설정된다.
+ */
+static void hr_block(int64_t wake)
+{
+	struct hr_sleeper sleeper;
+	enum intr_level old_level;
+
+	sleeper.wake = wake;
+	sleeper.thread = thread_current();
+
+	old_level = intr_disable();
+	list_insert_ordered(&hr_list, &sleeper.elem, hr_less, NULL);
+	hr_arm();
+	thread_block();
+	intr_set_level(old_level);
+}
+
+/* hr_less - 깨어날 시각이 이른 hr_sleeper가 앞에 오도록 비교한다.
+ */
+static bool hr_less(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+{
+	return list_entry(a, struct hr_sleeper, elem)->wake < list_entry(b, struct hr_sleeper, elem)->wake;
+}
+
+/* hr_run - 깨어날 시각이 된 hr_sleep() 스레드들을 깨운다. 타이머 인터럽트마다 호출된다.
+ * PIT와 TSC의 작은 오차로 인터럽트가 조금 일찍 들어와도 깨우며, 남은 시간은 hr_sleep()이 busy-wait로 채운다.
+ */
+static void hr_run(void)
+{
+	int64_t now;
+	bool woken = false;
+
+	if (list_empty(&hr_list))
+		return;
+
+	now = timer_ns() + HR_SLACK_NS / 2;
+	while (!list_empty(&hr_list))
+	{
+		struct hr_sleeper *sleeper = list_entry(list_front(&hr_list), struct hr_sleeper, elem);
+		if (sleeper->wake > now)
+			break;
+		list_pop_front(&hr_list);
+		thread_unblock(sleeper->thread);
+		woken = true;
+	}
+	if (woken)
+		thread_try_yield();
+}
+
+/* hr_arm - 가장 먼저 깨어날 hr_sleep() 스레드의 시각에 타이머 인터럽트가 들어오도록 PIT를 설정한다.
+ * 주기적인 틱이 흐르고 있다면, 그 시각이 현재 틱 안에 있을 때만 틱의 남은 시간을 one-shot 구간들로 나누어 센다.
+ * 이미 one-shot으로 세고 있다면 진행 중인 구간을 그 시각에서 끊는다.
+ * 곧 타이머 인터럽트가 들어온다면 그 인터럽트가 다음 구간을 정하므로 아무것도 하지 않는다.
+ */
+static void hr_arm(void)
+{
+	int64_t wake;
+	uint16_t remaining;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (list_empty(&hr_list) || tick_stopped)
+		return;
+	wake = list_entry(list_front(&hr_list), struct hr_sleeper, elem)->wake;
+
+	remaining = pit_read();
+	if (oneshot_ticks == 0)
+	{
+		if (wake >= tsc_to_ns(tick_tsc) + PIT_TICK_NS)
+			return;
+		if (remaining < HR_ARM_MIN_COUNT || pit_irq_pending())
+			return;
+		oneshot_ticks = 1;
+		oneshot_left = remaining;
+		oneshot_elapsed = 0;
+	}
+	else
+	{
+		if (pit_segment_done(remaining) || hr_pit_count(wake) >= remaining)
+			return;
+		oneshot_elapsed += oneshot_count - remaining;
+		oneshot_left += remaining;
+	}
+	pit_oneshot_next();
+}
+
+/* hr_pit_count - 지금부터 WAKE(ns)까지의 시간을 올림한 PIT 카운트로 반환한다. 최소 1, 최대 PIT_ONESHOT_MAX이다.
+ */
+static int64_t hr_pit_count(int64_t wake)
+{
+	int64_t ns = wake - timer_ns();
+
+	if (ns <= 0)
+		return 1;
+	if (ns >= PIT_ONESHOT_MAX * (1000000000LL / PIT_HZ))
+		return PIT_ONESHOT_MAX;
+	return (ns * PIT_HZ + 999999999) / 1000000000;
+}
+
 /* Sleep for approximately NUM/DENOM seconds. */
 static void real_time_sleep(int64_t num, int32_t denom)
 {
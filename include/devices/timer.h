@@ -1,23 +1,49 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* 커널 타이머.
+ * timer_add()로 등록하면 timer_ticks()가 EXPIRES에 도달한 틱의 타이머 인터럽트에서 FUNC(AUX)가 호출된다.
+ * FUNC는 외부 인터럽트 컨텍스트에서 실행되므로 sleep해서는 안된다. */
+typedef void timer_func (void *aux);
+
+struct timer {
+	struct list_elem elem;      /* 타이머 휠 슬롯의 리스트 요소. */
+	int64_t expires;            /* 만료되는 틱. */
+	timer_func *func;           /* 만료 시 호출할 함수. */
+	void *aux;                  /* FUNC에 전달할 인자. */
+	bool pending;               /* 휠에 등록되어 있는가? */
+};
+
 void timer_init (void);
 void timer_calibrate (void);
 
+/* -o nohz: Idle 상태에서 틱을 멈추는 dynamic tick 모드. */
+extern bool timer_nohz;
+void timer_idle_enter (void);
+void timer_irq_enter (uint8_t vec_no);
+
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
 
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_add (struct timer *, int64_t expires);
+bool timer_cancel (struct timer *);
+bool timer_pending (const struct timer *);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -36,6 +36,8 @@ bool bitmap_all (const struct bitmap *, size_t start, size_t cnt);
 #define BITMAP_ERROR SIZE_MAX
 size_t bitmap_scan (const struct bitmap *, size_t start, size_t cnt, bool);
 size_t bitmap_scan_and_flip (struct bitmap *, size_t start, size_t cnt, bool);
+size_t bitmap_scan_from_hint (const struct bitmap *, size_t *hint, size_t cnt, bool);
+size_t bitmap_scan_and_flip_from_hint (struct bitmap *, size_t *hint, size_t cnt, bool);
 
 /* File input and output. */
 #ifdef FILESYS
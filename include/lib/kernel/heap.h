@@ -0,0 +1,59 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/*
+ * 페어링 힙(pairing heap)
+ * list와 마찬가지로 동적 메모리 할당 없이 동작하는 침습형(intrusive) 자료구조이다.
+ * 힙에 들어갈 구조체는 struct heap_elem 멤버를 포함해야 하며,
+ * heap_entry 매크로로 struct heap_elem에서 포함하는 구조체로 변환할 수 있다.
+ *
+ * 힙의 top은 heap_less_func 기준으로 가장 "작은" 요소이다.
+ * 삽입은 O(1), top 조회는 O(1), pop과 임의 요소 삭제는 분할 상환 O(log n)이다.
+ * 키가 바뀐 요소는 heap_remove() 후 다시 heap_insert() 해야 한다.
+ * 같은 키를 가진 요소들 사이의 순서는 보장하지 않으므로, 순서가 필요하다면 비교 함수에서 직접 구분해야 한다.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* 가장 왼쪽 자식. */
+	struct heap_elem *next;     /* 오른쪽 형제. */
+	struct heap_elem *prev;     /* 왼쪽 형제, 가장 왼쪽 자식이라면 부모. */
+};
+
+/* 보조 데이터 AUX가 주어진 두 힙 요소 A와 B의 값을 비교한다.
+ * A가 B보다 먼저 나와야 하면 true를 반환한다.
+ */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* 가장 작은 요소, 비어 있다면 NULL. */
+	size_t size;                /* 요소의 수. */
+	heap_less_func *less;       /* 비교 함수. */
+	void *aux;                  /* 비교 함수의 보조 데이터. */
+};
+
+/*
+ * heap_entry MACRO : 힙 요소 HEAP_ELEM 포인터를 HEAP_ELEM이 포함된 구조체에 대한 포인터로 변환한다.
+ * STRUCT는 외부 구조체의 이름이고, MEMBER는 힙 요소의 멤버 이름이다.
+ */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER) \
+   ((STRUCT *)((uint8_t *)&(HEAP_ELEM)->next - offsetof(STRUCT, MEMBER.next)))
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (const struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
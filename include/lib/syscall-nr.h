@@ -36,6 +36,9 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra: per-process statistics */
+	SYS_GETRUSAGE,              /* Get CPU and scheduling statistics. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,6 +14,17 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* CPU and scheduling statistics filled in by getrusage().
+   All times are in nanoseconds. */
+struct rusage {
+	int64_t ru_runtime;         /* Time spent running. */
+	int64_t ru_waittime;        /* Time spent ready, waiting for a CPU. */
+	int64_t ru_blocktime;       /* Time spent blocked. */
+	uint64_t ru_nvcsw;          /* Voluntary context switches. */
+	uint64_t ru_nivcsw;         /* Involuntary context switches. */
+	uint64_t ru_pagefaults;     /* Page faults taken. */
+};
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -37,6 +49,7 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+int getrusage (struct rusage *usage);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
@@ -2,6 +2,7 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 void malloc_init (void);
@@ -9,5 +10,10 @@ void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_print_stats (void);
+
+/* Print allocator statistics at power off?
+   Controlled by kernel command-line option "-allocstat". */
+extern bool alloc_stat_enabled;
 
 #endif /* threads/malloc.h */
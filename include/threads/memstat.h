@@ -0,0 +1,23 @@
+#ifndef THREADS_MEMSTAT_H
+#define THREADS_MEMSTAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 할당의 종류. */
+enum memstat_kind {
+	MEMSTAT_MALLOC,             /* malloc(), calloc(), realloc(). */
+	MEMSTAT_PALLOC,             /* palloc_get_page(), palloc_get_multiple(). */
+};
+
+/* -memstat: 호출 지점별 커널 메모리 사용량을 기록하는가?
+ * 부팅 중 첫 할당보다 먼저 정해지며 이후에는 바뀌지 않는다. */
+extern bool memstat_enabled;
+
+uint16_t memstat_charge (enum memstat_kind, const void *site, size_t bytes);
+void memstat_uncharge (uint16_t tag, size_t bytes);
+void memstat_print (void);
+void memstat_request_dump (void);
+
+#endif /* threads/memstat.h */
@@ -28,6 +28,11 @@
 #define PTX(la)  ((((uint64_t) (la)) >> PTXSHIFT) & 0x1FF)
 #define PTE_ADDR(pte) ((uint64_t) (pte) & ~0xFFF)
 
+/* A page directory entry with PTE_PS maps a 2 MiB "huge" page
+   directly, without a page table. */
+#define HPGSIZE (1UL << PDXSHIFT)          /* Bytes in a huge page. */
+#define HPGMASK (HPGSIZE - 1)              /* Huge page offset bits (0:21). */
+
 /* The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
    ignored.
@@ -41,5 +46,6 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2 MiB page (PDEs only). */
 
 #endif /* threads/pte.h */
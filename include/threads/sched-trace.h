@@ -0,0 +1,33 @@
+#ifndef THREADS_SCHED_TRACE_H
+#define THREADS_SCHED_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* 스케줄러 이벤트의 종류. */
+enum sched_event {
+	SCHED_WAKEUP,               /* BLOCKED -> READY. ARG: 깨운 스레드의 tid. */
+	SCHED_SWITCH_IN,            /* CPU를 얻음. ARG: 직전에 실행되던 스레드의 tid. */
+	SCHED_SWITCH_OUT,           /* CPU를 내려놓음. ARG: 전환 후의 상태. */
+	SCHED_BLOCK,                /* RUNNING -> BLOCKED. */
+	SCHED_DONATE,               /* 우선순위를 기부받음. ARG: 기부한 스레드의 tid. */
+	SCHED_EXIT,                 /* 스레드 종료. ARG: exit status. */
+	SCHED_EVENT_CNT
+};
+
+/* -trace: 스케줄러 이벤트를 기록하는가? */
+extern bool sched_trace_enabled;
+
+void sched_trace_record (enum sched_event, const struct thread *, int arg);
+void sched_trace_dump (void);
+
+/* 기록이 꺼져 있을 때는 함수 호출 비용도 들지 않도록 매크로로 감싼다. */
+#define sched_trace(EVENT, T, ARG)                        \
+	do {                                                  \
+		if (sched_trace_enabled)                          \
+			sched_trace_record ((EVENT), (T), (ARG));     \
+	} while (0)
+
+#endif /* threads/sched-trace.h */
@@ -0,0 +1,40 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* 객체를 슬랩에 처음 만들 때 한 번 호출되는 생성자. */
+typedef void kmem_ctor_func (void *obj);
+
+/* 같은 크기의 객체를 위한 슬랩 캐시.
+ * 객체들은 한 페이지짜리 슬랩에 빈틈없이 놓이며, 빈 객체는 슬랩 안의 단일 연결 리스트로 관리한다. */
+struct kmem_cache {
+	const char *name;                   /* 통계 출력에 쓰는 이름. */
+	size_t obj_size;                    /* 정렬을 반영한 객체 크기. */
+	size_t free_ofs;                    /* 빈 객체에서 next 포인터를 두는 오프셋. */
+	size_t objs_per_slab;               /* 슬랩 하나에 들어가는 객체 수. */
+	kmem_ctor_func *ctor;               /* 생성자, 없으면 NULL. */
+	struct lock lock;                   /* 아래 리스트와 통계를 보호한다. */
+	struct list partial;                /* 빈 객체가 남아 있는 슬랩들. */
+	struct list full;                   /* 빈 객체가 없는 슬랩들. */
+	struct list_elem elem;              /* 전체 캐시 리스트의 원소. */
+
+	/* 통계. */
+	size_t slab_cnt;                    /* 가지고 있는 슬랩 수. */
+	size_t in_use;                      /* 사용 중인 객체 수. */
+	size_t peak;                        /* in_use의 최댓값. */
+	uint64_t alloc_cnt;                 /* kmem_cache_alloc() 성공 횟수. */
+	uint64_t free_cnt;                  /* kmem_cache_free() 횟수. */
+};
+
+void slab_init (void);
+void kmem_cache_create (struct kmem_cache *, const char *name, size_t size, kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void *kmem_cache_zalloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -2,12 +2,16 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <heap.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* 대기 중인 스레드의 힙 (우선순위 내림차순, 같으면 FIFO). */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,24 +24,45 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct heap_elem elem;      /* holder의 held_locks 힙 원소. */
+	int max_priority;           /* 대기자 중 가장 높은 우선순위 (캐시). */
+	struct lock_stat *stat;     /* 경합 통계, 이름 없는 잠금은 NULL. */
+};
+
+/* 이름 붙은 잠금의 경합 통계. -lockstat 옵션이 켜져 있을 때만 기록된다.
+ * 시간은 모두 나노초 단위이다. */
+struct lock_stat {
+	const char *name;           /* 잠금의 이름. */
+	uint64_t acquired;          /* 획득 횟수. */
+	uint64_t contended;         /* 기다려야 했던 획득 횟수. */
+	int64_t wait_total;         /* 획득까지 기다린 누적 시간. */
+	int64_t wait_max;           /* 획득까지 기다린 최대 시간. */
+	int64_t hold_total;         /* 보유한 누적 시간. */
+	int64_t hold_max;           /* 보유한 최대 시간. */
+	int64_t acquired_at;        /* 마지막으로 획득한 시각. */
 };
 
+extern bool lock_stat_enabled;
+
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
+void lock_print_stats (void);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+bool lock_priority_less (const struct heap_elem *a, const struct heap_elem *b, void *aux);
+int lock_donated_priority (struct thread *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* 대기 중인 semaphore_elem의 힙. */
 };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
-bool cond_priority(const struct list_elem *a, const struct list_elem  *b, void *aux);
 
 /* Optimization barrier.
  *
@@ -33,6 +33,17 @@ typedef int tid_t;
 #define FDT_PAGES 3
 #define FDT_SIZE (FDT_PAGES * (1<<9))
 
+/* 스레드별 스케줄링 통계. schedule()과 thread_tick()이 갱신하며 getrusage 시스템 콜로 노출된다. */
+struct thread_stats {
+	int64_t run_ns;                     /* RUNNING 상태로 보낸 누적 시간. */
+	int64_t wait_ns;                    /* READY 상태로 run queue에서 기다린 누적 시간. */
+	int64_t block_ns;                   /* BLOCKED 상태로 보낸 누적 시간. */
+	int64_t stamp_ns;                   /* 마지막으로 위 시간들을 정산한 시각. */
+	uint64_t nvcsw;                     /* 자발적 문맥 교환(BLOCKED로 전환) 횟수. */
+	uint64_t nivcsw;                    /* 비자발적 문맥 교환(선점, 양보) 횟수. */
+	uint64_t page_faults;               /* 페이지 폴트 횟수. */
+};
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -96,22 +107,29 @@ struct thread {
 	enum thread_status status;          /* Thread state. */
 	char name[16];                      /* Name (for debugging purposes). */
 	int priority;                       /* Priority. */
-	int64_t wakeup_ticks;                /* Time to wake up. */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 
 	/* For Priority Donation */
-	struct list donations; // 해당 스레드에게 기부를 해준 스레드
-	struct list_elem d_elem; // donations 리스트를 위한 list_elem
+	struct heap held_locks; // 보유 중인 잠금의 힙 (max_priority 내림차순)
 	struct lock *wait_on_lock; // 기다리고 있는 잠금
 	int original_priority; // 기부를 받기 전의 기존 우선순위
 
+	/* Shared between thread.c and synch.c. */
+	struct heap_elem wait_elem; // 세마포어 waiters 힙을 위한 heap_elem
+	struct semaphore *wait_on_sema; // 기다리고 있는 세마포어
+	uint64_t wait_seq; // 같은 우선순위의 대기자를 FIFO로 꺼내기 위한 순번
+	struct condition *wait_on_cond; // 신호를 기다리고 있는 조건 변수
+	struct heap_elem *cond_elem; // wait_on_cond의 waiters 힙에 들어 있는 semaphore_elem의 heap_elem
+
 	/* For MLFQS */
 	struct list_elem a_elem; // all_list를 위한 list_elem
 	int nice;
 	int recent_cpu;
+	int64_t decay_epoch; // recent_cpu에 반영된 감쇠 횟수
 
+	struct thread_stats stats;          /* 스케줄링 통계. */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -166,6 +184,9 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_try_yield (void);
+void thread_update_priority (struct thread *, int priority);
+void thread_get_stats (struct thread_stats *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
@@ -178,15 +199,12 @@ int thread_get_load_avg (void);
 void do_iret (struct intr_frame *tf);
 
 void thread_sleep(int64_t ticks);
-void thread_wakeup(int64_t ticks);
-bool less_wakeup_ticks(const struct list_elem *a, const struct list_elem *b, void *aux);
-bool higher_priority(const struct list_elem *a, const struct list_elem *b, void *aux);
+void thread_wakeup(void *t);
 
 void calculate_load_avg(void);
-void calculate_all_recent_cpu(void);
-int calculate_one_recent_cpu(struct thread *t);
+void calculate_recent_cpu_decay(void);
+int calculate_one_recent_cpu(struct thread *t, int decay);
 void recent_cpu_plus(void);
-void calculate_all_priority(void);
-int calculate_new_priority(struct thread *t);
+void calculate_current_priority(void);
 
 #endif /* threads/thread.h */
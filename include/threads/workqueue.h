@@ -0,0 +1,67 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+struct work;
+struct thread;
+
+/* 워커 스레드에서 실행될 작업 함수. */
+typedef void work_func (struct work *work);
+
+/* 지연 실행할 작업 하나.
+ * 보통 작업 대상 구조체에 포함시키고, 작업 함수에서 포함하는 구조체로 변환해 사용한다.
+ * 작업 함수는 자신의 struct work를 해제하거나 다시 queue_work() 할 수 있다. */
+struct work {
+	struct list_elem elem;              /* 워크큐의 pending 리스트 원소. */
+	work_func *func;                    /* 실행할 함수. */
+	struct workqueue *wq;               /* 마지막으로 들어간 워크큐. */
+	bool pending;                       /* 워크큐에서 실행을 기다리는 중인가? */
+};
+
+/* 일정 틱이 지난 뒤 워크큐에 들어가는 작업. */
+struct delayed_work {
+	struct work work;                   /* 실제 작업. */
+	struct timer timer;                 /* 만료되면 work를 워크큐에 넣는다. */
+};
+
+/* 워크큐 하나가 가질 수 있는 최대 워커 스레드 수. */
+#define WQ_MAX_WORKERS 4
+
+/* 워커 스레드 하나. */
+struct worker {
+	struct workqueue *wq;               /* 속한 워크큐. */
+	struct thread *thread;              /* 워커 스레드. */
+	struct work *current;               /* 실행 중인 작업, 없으면 NULL. */
+};
+
+/* 워크큐. 정해진 수의 워커 스레드가 pending 리스트의 작업을 FIFO로 꺼내 실행한다. */
+struct workqueue {
+	const char *name;                   /* 워커 스레드 이름의 접두사. */
+	struct list pending;                /* 실행을 기다리는 작업들. */
+	struct list idle_workers;           /* 할 일이 없어 BLOCKED 된 워커 스레드들. */
+	struct list flushers;               /* flush_work()에서 BLOCKED 된 스레드들. */
+	struct worker workers[WQ_MAX_WORKERS];
+	int worker_cnt;
+};
+
+/* 범용 워크큐. */
+extern struct workqueue system_wq;
+
+void workqueue_init (void);
+void workqueue_create (struct workqueue *, const char *name, int workers, int priority);
+bool workqueue_started (const struct workqueue *);
+
+void work_init (struct work *, work_func *);
+bool queue_work (struct workqueue *, struct work *);
+bool schedule_work (struct work *);
+void flush_work (struct work *);
+
+void delayed_work_init (struct delayed_work *, work_func *);
+bool queue_delayed_work (struct workqueue *, struct delayed_work *, int64_t ticks);
+bool cancel_delayed_work (struct delayed_work *);
+
+#endif /* threads/workqueue.h */
@@ -14,5 +14,9 @@ struct bitmap *swap_table;  // 0 - empty, 1 - filled
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_share (struct page *dst, struct page *src);
+void anon_swap_plug (void);
+void anon_swap_unplug (void);
+void anon_print_stats (void);
 
 #endif
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include "threads/palloc.h"
 #include "lib/kernel/hash.h"
+#include "threads/slab.h"
 
 enum vm_type {
 	/* page not initialized 
@@ -36,6 +37,7 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/vma.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -63,6 +65,8 @@ struct page {
 	/* Your implementation */
 	struct hash_elem hash_elem;		/*Hash table element*/
  	bool writable;
+	uint64_t *pml4;					/* 페이지를 가진 프로세스의 페이지 테이블. */
+	struct list_elem rmap_elem;		/* 올라가 있는 프레임의 rmap 원소. */
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union 
 	   유형별 데이터는 유니언에 바인딩된다. 
@@ -85,8 +89,11 @@ struct page {
    "프레임"의 표현입니다. */
 struct frame {
 	void *kva;	//프레임의 커널 가상 주소를 가리키는 포인터 -> 페이지 프레임이 실제로 메모리에서 어디에 위치하는지
-	struct page *page; //프레임이 참조하는 페이지를 가리키는 포인터 -> 해당 프레임이 어떤 페이지를 가리키는지
+	struct page *page; //프레임이 참조하는 페이지를 가리키는 포인터 -> 내보낼 때 이 페이지의 swap_out으로 내용을 쓴다
 	struct list_elem frame_elem; //frame 구조체의 list_elem
+	struct list rmap; //이 프레임을 매핑한 페이지들(역매핑) -> 각 페이지의 pml4와 va로 모든 매핑을 찾는다
+	bool pinned; //페이지를 올리거나 내보내는 중인지 -> 교체 대상에서 빠지고, 끝나면 frame_unpinned로 알린다
+	size_t ref_cnt; //rmap의 원소 수 -> fork 후 copy-on-write로 공유하면 2 이상
 };
 
 /* The function table for page operations.
@@ -117,7 +124,8 @@ struct page_operations {
  * 이 구조에 대해 특정 설계를 따르도록 강요하고 싶지 않습니다.
  * 모든 설계는 여러분의 몫입니다. */
 struct supplemental_page_table {
-	struct hash hash_table;
+	struct hash hash_table;		/* 한 번이라도 접근한 페이지들. */
+	struct vma_tree vmas;		/* ELF 세그먼트와 mmap 영역들. 페이지는 처음 접근할 때 만든다. */
 };
 
 #include "threads/thread.h"
@@ -130,7 +138,11 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+/* -o thp: 큰 익명 영역을 2 MiB 페이지로 매핑하는가? */
+extern bool thp_enabled;
+
 void vm_init (void);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
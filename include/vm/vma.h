@@ -0,0 +1,47 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+#include "vm/uninit.h"
+
+struct file;
+
+/* 프로세스 가상 주소 공간의 한 영역(ELF 세그먼트, mmap 하나).
+ * 영역은 등록할 때 한 번에 만들어지며, 페이지별 struct page는 처음 접근할 때 만들어진다. */
+struct vm_area {
+	void *start;                /* 첫 페이지의 주소. */
+	void *end;                  /* 마지막 페이지 다음의 주소. */
+	enum vm_type type;          /* 페이지를 만들 때 쓰는 유형. */
+	bool writable;              /* 쓰기 가능한가? */
+	vm_initializer *init;       /* 페이지를 처음 올릴 때 내용을 채우는 함수. */
+	struct file *file;          /* 내용을 읽어 올 파일, 없으면 NULL. */
+	off_t ofs;                  /* start에 해당하는 파일 오프셋. */
+	size_t read_bytes;          /* start부터 파일에서 읽는 바이트 수. 나머지는 0이다. */
+
+	/* 트리. */
+	struct vm_area *left;       /* start가 더 작은 영역들. */
+	struct vm_area *right;      /* start가 더 큰 영역들. */
+	int height;                 /* 이 영역을 뿌리로 하는 부분 트리의 높이. */
+};
+
+/* 서로 겹치지 않는 영역들의 트리. */
+struct vma_tree {
+	struct vm_area *root;       /* 뿌리, 비어 있다면 NULL. */
+	struct vm_area *hint;       /* 마지막으로 찾은 영역, 없으면 NULL. */
+	size_t cnt;                 /* 영역 수. */
+};
+
+void vma_init (void);
+void vma_tree_init (struct vma_tree *);
+struct vm_area *vma_create (struct vma_tree *, void *start, void *end,
+		enum vm_type type, bool writable, vm_initializer *init,
+		struct file *file, off_t ofs, size_t read_bytes);
+struct vm_area *vma_find (struct vma_tree *, const void *va);
+bool vma_overlaps (struct vma_tree *, const void *start, const void *end);
+bool vma_grow_down (struct vma_tree *, struct vm_area *, void *start);
+void vma_remove (struct vma_tree *, struct vm_area *);
+bool vma_copy (struct vma_tree *dst, struct vma_tree *src);
+void vma_tree_destroy (struct vma_tree *);
+#endif /* vm/vma.h */
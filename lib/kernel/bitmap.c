@@ -63,6 +63,50 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a mask of the bits of the element containing bit
+   START that lie in [START, END), along with the number of those
+   bits in *CNT. */
+static inline elem_type
+range_mask (size_t start, size_t end, size_t *cnt) {
+	size_t ofs = start % ELEM_BITS;
+	size_t n = ELEM_BITS - ofs < end - start ? ELEM_BITS - ofs : end - start;
+
+	*cnt = n;
+	return (n == ELEM_BITS ? (elem_type) -1 : ((elem_type) 1 << n) - 1) << ofs;
+}
+
+/* Returns the bits of element IDX of B, inverted if VALUE is
+   false, so that set bits are the ones equal to VALUE. */
+static inline elem_type
+elem_match (const struct bitmap *b, size_t idx, bool value) {
+	return value ? b->bits[idx] : ~b->bits[idx];
+}
+
+/* Returns the index of the first bit in B at or after START that
+   is set to VALUE, or the size of B if there is none.  Checks a
+   whole element at a time. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, bool value) {
+	size_t idx, bit;
+	elem_type w;
+
+	if (start >= b->bit_cnt)
+		return b->bit_cnt;
+
+	idx = elem_idx (start);
+	w = elem_match (b, idx, value) & ((elem_type) -1 << (start % ELEM_BITS));
+	while (w == 0) {
+		if (++idx >= elem_cnt (b->bit_cnt))
+			return b->bit_cnt;
+		w = elem_match (b, idx, value);
+	}
+
+	/* Bits past the end of the last element are 0, so they match
+	   when VALUE is false; clamp those to the end. */
+	bit = idx * ELEM_BITS + __builtin_ctzl (w);
+	return bit < b->bit_cnt ? bit : b->bit_cnt;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -194,33 +238,51 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	size_t end = start + cnt, n;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	for (; start < end; start += n) {
+		elem_type mask = range_mask (start, end, &n);
+		elem_type *e = &b->bits[elem_idx (start)];
+
+		/* See bitmap_mark() and bitmap_reset(). */
+		if (value)
+			asm ("lock orq %1, %0" : "+m" (*e) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "+m" (*e) : "r" (~mask) : "cc");
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t value_cnt;
+
+	size_t end = start + cnt, n;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
 	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
+	for (; start < end; start += n) {
+		elem_type w = elem_match (b, elem_idx (start), value)
+			& range_mask (start, end, &n);
+
+		if (w == (elem_type) -1)
+			value_cnt += ELEM_BITS;
+		else
+			for (; w != 0; w &= w - 1)
+				value_cnt++;
+	}
 	return value_cnt;
 }
 
@@ -228,14 +290,14 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	size_t end = start + cnt, n;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
+	for (; start < end; start += n)
+		if (elem_match (b, elem_idx (start), value) & range_mask (start, end, &n))
 			return true;
 	return false;
 }
@@ -266,22 +328,55 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Runs of bits are found a whole element at a time: we jump to
+   the next bit set to VALUE, then to the next bit set to !VALUE
+   after it, and check whether the run between them is long
+   enough.  Full elements are skipped without looking at their
+   bits one by one. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+	if (cnt == 0)
+		return start;
+	while (cnt <= b->bit_cnt - start) {
+		size_t first = next_bit (b, start, value);
+		size_t end;
+
+		if (cnt > b->bit_cnt - first)
+			break;
+		end = next_bit (b, first, !value);
+		if (end - first >= cnt)
+			return first;
+		start = end;
 	}
 	return BITMAP_ERROR;
 }
 
+/* Like bitmap_scan(), but searches next-fit: starts at *HINT and
+   wraps around to the beginning of B if nothing is found after
+   it.  On success, advances *HINT past the group found, so that
+   consecutive allocations do not rescan the full prefix of B.
+   *HINT may be any value; values past the end count as 0. */
+size_t
+bitmap_scan_from_hint (const struct bitmap *b, size_t *hint, size_t cnt, bool value) {
+	size_t start, idx;
+
+	ASSERT (b != NULL);
+	ASSERT (hint != NULL);
+
+	start = *hint < b->bit_cnt ? *hint : 0;
+	idx = bitmap_scan (b, start, cnt, value);
+	if (idx == BITMAP_ERROR && start > 0)
+		idx = bitmap_scan (b, 0, cnt, value);
+	if (idx != BITMAP_ERROR)
+		*hint = idx + cnt;
+	return idx;
+}
+
 /* Finds the first group of CNT consecutive bits in B at or after
    START that are all set to VALUE, flips them all to !VALUE,
    and returns the index of the first bit in the group.
@@ -296,6 +391,16 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value) {
 		bitmap_set_multiple (b, idx, cnt, !value);
 	return idx;
 }
+
+/* Like bitmap_scan_and_flip(), but searches next-fit from *HINT
+   as bitmap_scan_from_hint() does. */
+size_t
+bitmap_scan_and_flip_from_hint (struct bitmap *b, size_t *hint, size_t cnt, bool value) {
+	size_t idx = bitmap_scan_from_hint (b, hint, cnt, value);
+	if (idx != BITMAP_ERROR)
+		bitmap_set_multiple (b, idx, cnt, !value);
+	return idx;
+}
 
 /* File input and output. */
 
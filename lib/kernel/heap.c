@@ -0,0 +1,177 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* 페어링 힙은 각 노드가 자식들을 왼쪽에서 오른쪽으로 잇는 형제 리스트를 가지는 다진 트리이다.
+ * 모든 노드는 자신의 자식들보다 작거나 같다.
+ * 가장 왼쪽 자식의 prev는 부모를, 나머지 자식의 prev는 왼쪽 형제를 가리키므로
+ * 임의의 노드를 O(1)에 트리에서 떼어낼 수 있다.
+
+   A heap with root R whose children are A, B and C looks like this:
+
+        R
+        |
+        A <---> B <---> C
+        |               |
+        D               E
+
+   (A->prev == R, B->prev == A, C->prev == B, D->prev == A.)
+*/
+
+/* meld - 두 트리 A와 B를 합쳐 하나의 트리로 만들고 그 루트를 반환한다.
+ * 루트가 더 큰 쪽이 다른 쪽의 가장 왼쪽 자식이 된다.
+ * A와 B는 형제가 없는 루트여야 한다.
+ */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b)
+{
+	struct heap_elem *tmp;
+
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (heap->less (b, a, heap->aux))
+	{
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* merge_pairs - FIRST부터 시작하는 형제 리스트를 하나의 트리로 합치고 그 루트를 반환한다.
+ * 왼쪽에서 오른쪽으로 둘씩 짝지어 합친 뒤, 그 결과들을 오른쪽에서 왼쪽으로 합친다(two-pass).
+ */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first)
+{
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *result = NULL;
+
+	/* 첫 번째 패스: 짝지어 합친 결과를 역순으로 PAIRS에 쌓는다. */
+	while (first != NULL)
+	{
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+
+		a = meld (heap, a, b);
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* 두 번째 패스: 오른쪽부터 차례로 합친다. */
+	while (pairs != NULL)
+	{
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		result = meld (heap, result, pairs);
+		pairs = next;
+	}
+	return result;
+}
+
+/* Initializes HEAP as an empty heap ordered by LESS given auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux)
+{
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->size = 0;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_insert (struct heap *heap, struct heap_elem *elem)
+{
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = meld (heap, heap->root, elem);
+	heap->size++;
+}
+
+/* Returns the smallest element in HEAP without removing it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap)
+{
+	ASSERT (!heap_empty (heap));
+	return heap->root;
+}
+
+/* Removes and returns the smallest element in HEAP.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_pop (struct heap *heap)
+{
+	struct heap_elem *top = heap_top (heap);
+
+	heap->root = merge_pairs (heap, top->child);
+	heap->size--;
+	top->child = top->next = top->prev = NULL;
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem)
+{
+	struct heap_elem *sub;
+
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	if (elem == heap->root)
+	{
+		heap_pop (heap);
+		return;
+	}
+
+	/* 부모의 자식 리스트 또는 형제 리스트에서 ELEM을 떼어낸다. */
+	ASSERT (elem->prev != NULL);
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->next;
+	else
+		elem->prev->next = elem->next;
+	if (elem->next != NULL)
+		elem->next->prev = elem->prev;
+
+	/* ELEM의 자식들을 하나로 합쳐 루트와 다시 합친다. */
+	sub = merge_pairs (heap, elem->child);
+	heap->root = meld (heap, heap->root, sub);
+	heap->size--;
+	elem->child = elem->next = elem->prev = NULL;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap)
+{
+	ASSERT (heap != NULL);
+	return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap)
+{
+	ASSERT (heap != NULL);
+	return heap->root == NULL;
+}
@@ -0,0 +1,19 @@
+# Checks the output of a benchmark against EXPECTED.  Timings vary
+# from run to run, so every number in a "time:" line is replaced by
+# "#" before the comparison.  That still checks that each timing was
+# reported, in order and in the expected form, along with the
+# benchmark's correctness lines.
+sub check_bench {
+    my ($expected) = @_;
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    local ($_);
+    s/\d+/#/g foreach grep (/^\([^)]+\) time: /, @output);
+    compare_output ("run", \@output, [$expected]);
+    pass;
+}
+
+1;
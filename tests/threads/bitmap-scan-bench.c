@@ -0,0 +1,121 @@
+/* Measures bitmap_scan() on a nearly full bitmap, the situation
+   of a busy swap table or disk free map.  Every 64th bit starts
+   out free.  Each round allocates every free bit one at a time,
+   first-fit with bitmap_scan_and_flip() and then next-fit with
+   bitmap_scan_and_flip_from_hint(), and frees them again.  A
+   bit-at-a-time reference scan, as bitmap_scan() used to be,
+   checks the results and gives the baseline time. */
+
+#include <bitmap.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+#define BITS 16384
+#define STRIDE 64
+
+static size_t reference_scan (const struct bitmap *, size_t start,
+                              size_t cnt, bool value);
+static void fill (struct bitmap *);
+
+void
+test_bitmap_scan_bench (void) 
+{
+  struct bitmap *b = bitmap_create (BITS);
+  size_t free_cnt = BITS / STRIDE;
+  size_t hint = 0;
+  int64_t start, reference_ns, first_fit_ns, next_fit_ns;
+  size_t i;
+
+  if (b == NULL)
+    fail ("bitmap_create failed");
+
+  /* Reference: bit-at-a-time first fit. */
+  fill (b);
+  start = timer_ns ();
+  for (i = 0; i < free_cnt; i++)
+    {
+      size_t idx = reference_scan (b, 0, 1, false);
+      if (idx != i * STRIDE)
+        fail ("reference scan found %zu, expected %zu", idx, i * STRIDE);
+      bitmap_mark (b, idx);
+    }
+  reference_ns = timer_ns () - start;
+  if (reference_scan (b, 0, 1, false) != BITMAP_ERROR)
+    fail ("reference scan found a bit in a full bitmap");
+  msg ("bit-at-a-time first fit found every free bit in order.");
+
+  /* Word-at-a-time first fit. */
+  fill (b);
+  start = timer_ns ();
+  for (i = 0; i < free_cnt; i++)
+    {
+      size_t idx = bitmap_scan_and_flip (b, 0, 1, false);
+      if (idx != i * STRIDE)
+        fail ("bitmap_scan found %zu, expected %zu", idx, i * STRIDE);
+    }
+  first_fit_ns = timer_ns () - start;
+  if (bitmap_scan (b, 0, 1, false) != BITMAP_ERROR)
+    fail ("bitmap_scan found a bit in a full bitmap");
+  msg ("word-at-a-time first fit found every free bit in order.");
+
+  /* Word-at-a-time next fit. */
+  fill (b);
+  start = timer_ns ();
+  for (i = 0; i < free_cnt; i++)
+    {
+      size_t idx = bitmap_scan_and_flip_from_hint (b, &hint, 1, false);
+      if (idx != i * STRIDE)
+        fail ("bitmap_scan_from_hint found %zu, expected %zu",
+              idx, i * STRIDE);
+    }
+  next_fit_ns = timer_ns () - start;
+  if (bitmap_scan_from_hint (b, &hint, 1, false) != BITMAP_ERROR)
+    fail ("bitmap_scan_from_hint found a bit in a full bitmap");
+  msg ("word-at-a-time next fit found every free bit in order.");
+
+  /* Multi-bit groups must not straddle a used bit. */
+  fill (b);
+  bitmap_set_multiple (b, 1000, 40, false);
+  if (bitmap_scan (b, 0, 40, false) != 1000
+      || bitmap_scan (b, 0, 41, false) != BITMAP_ERROR)
+    fail ("multi-bit scan returned a wrong group");
+  msg ("multi-bit scan found the only group that fits.");
+
+  msg ("%zu allocations in a %d-bit map:", free_cnt, BITS);
+  msg ("time: bit-at-a-time first fit: %lld us", reference_ns / 1000);
+  msg ("time: word-at-a-time first fit: %lld us", first_fit_ns / 1000);
+  msg ("time: word-at-a-time next fit: %lld us", next_fit_ns / 1000);
+  bitmap_destroy (b);
+  pass ();
+}
+
+/* Marks every bit of B used except every STRIDE'th one. */
+static void
+fill (struct bitmap *b) 
+{
+  size_t i;
+
+  bitmap_set_all (b, true);
+  for (i = 0; i < bitmap_size (b); i += STRIDE)
+    bitmap_reset (b, i);
+}
+
+/* The bit-at-a-time bitmap_scan() this benchmark compares
+   against. */
+static size_t
+reference_scan (const struct bitmap *b, size_t start, size_t cnt,
+                bool value) 
+{
+  size_t i, j;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
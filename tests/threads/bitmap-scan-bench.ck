@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (<<'EOF');
+(bitmap-scan-bench) begin
+(bitmap-scan-bench) bit-at-a-time first fit found every free bit in order.
+(bitmap-scan-bench) word-at-a-time first fit found every free bit in order.
+(bitmap-scan-bench) word-at-a-time next fit found every free bit in order.
+(bitmap-scan-bench) multi-bit scan found the only group that fits.
+(bitmap-scan-bench) 256 allocations in a 16384-bit map:
+(bitmap-scan-bench) time: bit-at-a-time first fit: # us
+(bitmap-scan-bench) time: word-at-a-time first fit: # us
+(bitmap-scan-bench) time: word-at-a-time next fit: # us
+(bitmap-scan-bench) PASS
+(bitmap-scan-bench) end
+EOF
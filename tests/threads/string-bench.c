@@ -0,0 +1,191 @@
+/* Measures memcpy(), memset(), memcmp() and strlen() against
+   the byte-at-a-time loops they used to be, plus copy_page() and
+   clear_page(), in CPU cycles per call as counted by rdtsc.
+   Before timing, the results are checked on every size up to a
+   few words at every alignment within a word, which covers the
+   head, string-instruction and tail paths. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define ROUNDS 64
+
+static void check (uint8_t *a, uint8_t *b);
+static void bench_size (uint8_t *a, uint8_t *b, size_t size);
+static void *byte_memcpy (void *, const void *, size_t);
+static void *byte_memset (void *, int, size_t);
+static int byte_memcmp (const void *, const void *, size_t);
+static size_t byte_strlen (const char *);
+
+/* Keeps the results of timed calls alive. */
+static volatile long sink;
+
+/* Cycles per call of STMT, the best of ROUNDS runs. */
+#define CYCLES(STMT)                                    \
+  ({                                                    \
+    uint64_t best_ = UINT64_MAX;                        \
+    int r_;                                             \
+    for (r_ = 0; r_ < ROUNDS; r_++)                     \
+      {                                                 \
+        uint64_t start_ = rdtsc ();                     \
+        STMT;                                           \
+        uint64_t cycles_ = rdtsc () - start_;           \
+        if (cycles_ < best_)                            \
+          best_ = cycles_;                              \
+      }                                                 \
+    best_;                                              \
+  })
+
+void
+test_string_bench (void) 
+{
+  uint8_t *a = palloc_get_multiple (PAL_ZERO, 2);
+  uint8_t *b = palloc_get_multiple (PAL_ZERO, 2);
+  static const size_t sizes[] = {16, 64, 512, PGSIZE};
+  size_t i;
+
+  if (a == NULL || b == NULL)
+    fail ("palloc_get_multiple failed");
+
+  check (a, b);
+  msg ("memcpy, memset, memcmp and strlen match the byte loops.");
+
+  msg ("cycles per call, byte loop -> lib/string.c:");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    bench_size (a, b, sizes[i]);
+
+  memset (a, 0x5a, PGSIZE);
+  msg ("time: copy_page %llu, clear_page %llu",
+       (unsigned long long) CYCLES (copy_page (b, a)),
+       (unsigned long long) CYCLES (clear_page (b)));
+  copy_page (b, a);
+  if (memcmp (a, b, PGSIZE))
+    fail ("copy_page result differs");
+  clear_page (b);
+  for (i = 0; i < PGSIZE; i++)
+    if (b[i] != 0)
+      fail ("clear_page left byte %zu nonzero", i);
+  msg ("copy_page and clear_page results are correct.");
+
+  palloc_free_multiple (a, 2);
+  palloc_free_multiple (b, 2);
+  pass ();
+}
+
+/* Compares the results of the library functions with the byte
+   loops on every small size and alignment. */
+static void
+check (uint8_t *a, uint8_t *b) 
+{
+  size_t ofs, size, i;
+
+  for (i = 0; i < 2 * PGSIZE; i++)
+    a[i] = i * 7 + 1;
+
+  for (ofs = 0; ofs < 8; ofs++)
+    for (size = 0; size < 96; size++)
+      {
+        memset (b, 0, 2 * PGSIZE);
+        memcpy (b + ofs, a + (ofs * 3) % 8, size);
+        if (memcmp (b + ofs, a + (ofs * 3) % 8, size)
+            || byte_memcmp (b + ofs, a + (ofs * 3) % 8, size)
+            || b[ofs + size] != 0)
+          fail ("memcpy of %zu bytes at offset %zu is wrong", size, ofs);
+
+        memset (b + ofs, 0xa5, size);
+        for (i = 0; i < ofs + size + 8; i++)
+          if (b[i] != (i >= ofs && i < ofs + size ? 0xa5 : 0))
+            fail ("memset of %zu bytes at offset %zu is wrong", size, ofs);
+
+        if (size > 0)
+          {
+            memcpy (b + ofs, a + ofs, size);
+            b[ofs + size - 1]++;
+            if (memcmp (a + ofs, b + ofs, size) >= 0
+                || memcmp (b + ofs, a + ofs, size) <= 0)
+              fail ("memcmp of %zu bytes at offset %zu is wrong", size, ofs);
+          }
+
+        b[ofs + size] = '\0';
+        if (strlen ((char *) b + ofs) != byte_strlen ((char *) b + ofs))
+          fail ("strlen of %zu bytes at offset %zu is wrong", size, ofs);
+      }
+}
+
+/* Prints the cycles per call of each function for SIZE bytes. */
+static void
+bench_size (uint8_t *a, uint8_t *b, size_t size) 
+{
+  uint64_t copy_old, copy_new, set_old, set_new;
+  uint64_t cmp_old, cmp_new, len_old, len_new;
+
+  copy_old = CYCLES (byte_memcpy (b, a, size));
+  copy_new = CYCLES (memcpy (b, a, size));
+  set_old = CYCLES (byte_memset (b, 0, size));
+  set_new = CYCLES (memset (b, 0, size));
+
+  memcpy (b, a, size);
+  cmp_old = CYCLES (sink = byte_memcmp (a, b, size));
+  cmp_new = CYCLES (sink = memcmp (a, b, size));
+
+  memset (b, 'x', size);
+  b[size - 1] = '\0';
+  len_old = CYCLES (sink = byte_strlen ((char *) b));
+  len_new = CYCLES (sink = strlen ((char *) b));
+
+  msg ("time: %zu bytes: memcpy %llu -> %llu, memset %llu -> %llu, "
+       "memcmp %llu -> %llu, strlen %llu -> %llu", size,
+       (unsigned long long) copy_old, (unsigned long long) copy_new,
+       (unsigned long long) set_old, (unsigned long long) set_new,
+       (unsigned long long) cmp_old, (unsigned long long) cmp_new,
+       (unsigned long long) len_old, (unsigned long long) len_new);
+}
+
+/* The byte-at-a-time versions this benchmark compares against. */
+
+static void *
+byte_memcpy (void *dst_, const void *src_, size_t size) 
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+static void *
+byte_memset (void *dst_, int value, size_t size) 
+{
+  unsigned char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+static int
+byte_memcmp (const void *a_, const void *b_, size_t size) 
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+byte_strlen (const char *string) 
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (<<'EOF');
+(string-bench) begin
+(string-bench) memcpy, memset, memcmp and strlen match the byte loops.
+(string-bench) cycles per call, byte loop -> lib/string.c:
+(string-bench) time: # bytes: memcpy # -> #, memset # -> #, memcmp # -> #, strlen # -> #
+(string-bench) time: # bytes: memcpy # -> #, memset # -> #, memcmp # -> #, strlen # -> #
+(string-bench) time: # bytes: memcpy # -> #, memset # -> #, memcmp # -> #, strlen # -> #
+(string-bench) time: # bytes: memcpy # -> #, memset # -> #, memcmp # -> #, strlen # -> #
+(string-bench) time: copy_page #, clear_page #
+(string-bench) copy_page and clear_page results are correct.
+(string-bench) PASS
+(string-bench) end
+EOF
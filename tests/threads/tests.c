@@ -29,6 +29,9 @@ static const struct test tests[] =
         {"priority-preempt", test_priority_preempt},
         {"priority-sema", test_priority_sema},
         {"priority-condvar", test_priority_condvar},
+        {"thread-create-bench", test_thread_create_bench},
+        {"bitmap-scan-bench", test_bitmap_scan_bench},
+        {"string-bench", test_string_bench},
         {"mlfqs-load-1", test_mlfqs_load_1},
         {"mlfqs-load-60", test_mlfqs_load_60},
         {"mlfqs-load-avg", test_mlfqs_load_avg},
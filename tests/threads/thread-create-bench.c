@@ -0,0 +1,60 @@
+/* Measures the throughput of creating threads that exit
+   immediately.  Each child runs at a higher priority than the
+   main thread, so it runs to completion inside thread_create().
+   The main thread then yields so that dead threads can be
+   reaped and recycled before the next creation. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 1000
+
+static thread_func bench_thread;
+static struct semaphore done;
+
+void
+test_thread_create_bench (void) 
+{
+  int64_t start, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+
+  /* Warm up, so that the first iterations do not measure cold
+     page allocations. */
+  for (i = 0; i < 16; i++)
+    {
+      thread_create ("warmup", PRI_DEFAULT + 1, bench_thread, NULL);
+      sema_down (&done);
+      thread_yield ();
+    }
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      if (thread_create ("bench", PRI_DEFAULT + 1, bench_thread, NULL)
+          == TID_ERROR)
+        fail ("thread_create failed after %d threads", i);
+      sema_down (&done);
+      thread_yield ();
+    }
+  elapsed = timer_ns () - start;
+
+  msg ("%d threads created and exited.", ITERATIONS);
+  msg ("time: %lld us, %lld ns per thread", elapsed / 1000,
+       elapsed / ITERATIONS);
+  pass ();
+}
+
+static void 
+bench_thread (void *aux UNUSED) 
+{
+  sema_up (&done);
+}
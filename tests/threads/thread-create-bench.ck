@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (<<'EOF');
+(thread-create-bench) begin
+(thread-create-bench) 1000 threads created and exited.
+(thread-create-bench) time: # us, # ns per thread
+(thread-create-bench) PASS
+(thread-create-bench) end
+EOF
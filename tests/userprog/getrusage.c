@@ -0,0 +1,39 @@
+/* Calls getrusage() and checks that the run time and voluntary
+   context switch counters are non-zero and increase. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  int spins;
+  int pid;
+
+  CHECK (getrusage (&before) == 0, "getrusage");
+  if (before.ru_runtime <= 0)
+    fail ("run time is %lld", before.ru_runtime);
+
+  /* Spin until the run time moves. */
+  for (spins = 0; ; spins++)
+    {
+      if (spins >= 100000000)
+        fail ("run time did not increase");
+      getrusage (&after);
+      if (after.ru_runtime > before.ru_runtime)
+        break;
+    }
+  msg ("run time increased");
+
+  /* Waiting for a child blocks, which is a voluntary switch. */
+  if ((pid = fork ("child")) == 0)
+    exit (81);
+  wait (pid);
+  CHECK (getrusage (&after) == 0, "getrusage");
+  if (after.ru_nvcsw == 0 || after.ru_nvcsw <= before.ru_nvcsw)
+    fail ("voluntary switches went from %llu to %llu",
+          before.ru_nvcsw, after.ru_nvcsw);
+  msg ("voluntary switches increased");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) getrusage
+(getrusage) run time increased
+child: exit(81)
+(getrusage) getrusage
+(getrusage) voluntary switches increased
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Checks that a child's read() into a buffer shared copy-on-write
+   with its parent breaks the sharing instead of writing through to
+   the parent's copy. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+static char buf[4096];
+
+void
+test_main (void)
+{
+	pid_t child;
+	int handle;
+	size_t i;
+
+	memset (buf, 'x', sizeof buf);
+
+	child = fork ("child");
+	if (child == 0) {
+		CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+		CHECK (read (handle, buf, sizeof sample - 1) == (int) sizeof sample - 1,
+				"read \"sample.txt\"");
+		CHECK (memcmp (buf, sample, sizeof sample - 1) == 0, "check data change");
+		close (handle);
+		return;
+	}
+	wait (child);
+	for (i = 0; i < sizeof buf; i++)
+		if (buf[i] != 'x')
+			fail ("byte %zu of parent's buffer has value %02hhx (should be 78)",
+					i, buf[i]);
+	msg ("check data consistency");
+}
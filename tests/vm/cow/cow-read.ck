@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-read) begin
+(cow-read) open "sample.txt"
+(cow-read) read "sample.txt"
+(cow-read) check data change
+(cow-read) end
+(cow-read) check data consistency
+(cow-read) end
+EOF
+pass;
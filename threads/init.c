@@ -17,10 +17,15 @@
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/memstat.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/sched-trace.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -88,6 +93,7 @@ int main(void)
 	// 메모리 시스템 초기화
 	mem_end = palloc_init();
 	malloc_init();
+	slab_init();
 	paging_init(mem_end);
 
 #ifdef USERPROG
@@ -108,6 +114,7 @@ int main(void)
 #endif
 	// 스레드 스케줄러 시작 및 인터럽트 활성화
 	thread_start(); // 가장 실행 우선 순위가 낮은 idle이라는 스레드를 생성하고 실행한다.
+	workqueue_init(); // 지연 작업을 실행할 워커 스레드를 만든다.
 	serial_init_queue();
 	timer_calibrate();
 
@@ -227,12 +234,36 @@ static char **parse_options(char **argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-trace"))
+			sched_trace_enabled = true;
+		else if (!strcmp(name, "-lockstat"))
+			lock_stat_enabled = true;
+		else if (!strcmp(name, "-allocstat"))
+			alloc_stat_enabled = true;
+		else if (!strcmp(name, "-memstat"))
+			memstat_enabled = true;
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
 		else if (!strcmp(name, "-threads-tests"))
 			thread_tests = true;
 #endif
+		else if (!strcmp(name, "-o"))
+		{
+			/* `-o nohz'와 `-o=nohz'를 모두 받는다. */
+			if (value == NULL && (value = argv[1]) != NULL)
+				argv++;
+			if (value == NULL)
+				PANIC("option `-o' requires a value (use -h for help)");
+			else if (!strcmp(value, "nohz"))
+				timer_nohz = true;
+#ifdef VM
+			else if (!strcmp(value, "thp"))
+				thp_enabled = true;
+#endif
+			else
+				PANIC("unknown -o value `%s' (use -h for help)", value);
+		}
 		else
 			PANIC("unknown option `%s' (use -h for help)", name);
 	}
@@ -261,6 +292,18 @@ static void run_task(char **argv)
 	printf("Execution of '%s' complete.\n", task);
 }
 
+/* 스케줄러 이벤트 트레이스를 콘솔로 출력한다. */
+static void trace_dump(char **argv UNUSED)
+{
+	sched_trace_dump();
+}
+
+/* 커널 메모리 사용량 통계를 콘솔로 출력한다. */
+static void memstat_dump(char **argv UNUSED)
+{
+	memstat_print();
+}
+
 /* ARGV[]에 지정된 모든 액션을 널 포인터 센티널까지 실행한다.
  */
 static void run_actions(char **argv)
@@ -276,6 +319,8 @@ static void run_actions(char **argv)
 	/* Table of supported actions. */
 	static const struct action actions[] = {
 		{"run", 2, run_task},
+		{"trace", 1, trace_dump},
+		{"memstat", 1, memstat_dump},
 #ifdef FILESYS
 		{"ls", 1, fsutil_ls},
 		{"cat", 2, fsutil_cat},
@@ -322,6 +367,8 @@ static void usage(void)
 #else
 		   "  run TEST           Run TEST.\n"
 #endif
+		   "  trace              Dump the scheduler event trace (see -trace).\n"
+		   "  memstat            Dump kernel memory usage (see -memstat).\n"
 #ifdef FILESYS
 		   "  ls                 List files in the root directory.\n"
 		   "  cat FILE           Print FILE to the console.\n"
@@ -336,8 +383,16 @@ static void usage(void)
 		   "  -f                 Format file system disk during startup.\n"
 		   "  -rs=SEED           Set random number seed to SEED.\n"
 		   "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+		   "  -trace             Record scheduler events for the `trace' action.\n"
+		   "  -lockstat          Print lock contention statistics at power off.\n"
+		   "  -allocstat         Print malloc and slab statistics at power off.\n"
+		   "  -memstat           Account kernel allocations per call site.\n"
 #ifdef USERPROG
 		   "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+		   "  -o nohz            Stop the timer tick while the CPU is idle.\n"
+#ifdef VM
+		   "  -o thp             Map large anonymous regions with 2 MiB pages.\n"
 #endif
 	);
 	power_off();
@@ -367,9 +422,16 @@ static void print_stats(void)
 #ifdef FILESYS
 	disk_print_stats();
 #endif
+	lock_print_stats();
+	malloc_print_stats();
+	kmem_print_stats();
+	memstat_print();
 	console_print_stats();
 	kbd_print_stats();
 #ifdef USERPROG
 	exception_print_stats();
 #endif
+#ifdef VM
+	vm_print_stats();
+#endif
 }
@@ -347,6 +347,9 @@ intr_handler (struct intr_frame *frame) {
 
 		in_external_intr = true;
 		yield_on_return = false;
+
+		/* 틱이 멈춰 있었다면 그동안 지난 틱을 먼저 반영한다. */
+		timer_irq_enter (frame->vec_no);
 	}
 
 	/* Invoke the interrupt's handler. */
@@ -5,15 +5,20 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/memstat.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  Besides powers of 2, there are
+   classes halfway between them (48, 96, ...) so that a request
+   wastes at most about a third of its block, and the largest
+   classes are chosen to pack 3, 2 and 1 blocks into a page.
+   The descriptor keeps a list of free blocks.  If
    the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
@@ -24,15 +29,22 @@
    list.  Then we return one of the new blocks.
 
    When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
-
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   If the arena that the block was in now has no in-use blocks,
+   it stays on the free list as long as the descriptor has at
+   most ARENA_CACHE_MAX empty arenas, so a loop that allocates
+   and frees a single block does not get and free a page every
+   time.  Past that, we remove all of the arena's blocks from the
+   free list and give the arena back to the page allocator.
+
+   We can't handle blocks bigger than a page minus the arena
+   header using this scheme.  We handle those by allocating
+   contiguous pages with the page allocator and sticking the
+   allocation size at the beginning of the allocated block's
+   arena header.
+
+   With -memstat, every block starts with a struct tag_hdr that
+   records the requested size and the memstat tag of the call
+   site, and the caller gets the bytes just past it. */
 
 /* Descriptor. */
 struct desc {
@@ -40,8 +52,25 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+	size_t empty_cnt;           /* Arenas with no blocks in use. */
+
+	/* 통계. */
+	size_t arena_cnt;           /* Arenas owned. */
+	size_t in_use;              /* Blocks in use. */
+	size_t peak;                /* Maximum of in_use. */
+	uint64_t alloc_cnt;         /* Successful allocations. */
+	uint64_t req_bytes;         /* Sum of requested sizes. */
+};
+
+/* Header in front of each block when memstat_enabled. */
+struct tag_hdr {
+	uint32_t size;              /* Requested size. */
+	uint16_t tag;               /* memstat tag of the call site. */
 };
 
+/* Maximum number of empty arenas a descriptor keeps. */
+#define ARENA_CACHE_MAX 2
+
 /* Magic number for detecting arena corruption. */
 #define ARENA_MAGIC 0x9a548eed
 
@@ -57,32 +86,96 @@ struct block {
 	struct list_elem free_elem; /* Free list element. */
 };
 
+/* Block sizes of the descriptors, in increasing order.  The last
+   three are the largest sizes that fit 3, 2 and 1 blocks into a
+   page after the arena header. */
+#define CLASS_BYTES(BLOCKS) \
+	((PGSIZE - sizeof (struct arena)) / (BLOCKS) / 8 * 8)
+static const size_t class_sizes[] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024,
+	CLASS_BYTES (3), CLASS_BYTES (2), CLASS_BYTES (1),
+};
+
+/* Largest size served by a descriptor. */
+#define MAX_CLASS_BYTES CLASS_BYTES (1)
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[sizeof class_sizes / sizeof *class_sizes];
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* size_to_desc[(SIZE + 7) / 8] is the index of the smallest
+   descriptor whose blocks hold SIZE bytes. */
+static uint8_t size_to_desc[MAX_CLASS_BYTES / 8 + 1];
+
+/* Big block statistics. */
+static struct lock big_lock;    /* Protects the two below. */
+static uint64_t big_alloc_cnt;  /* Big blocks allocated. */
+static size_t big_pages;        /* Pages in big blocks in use. */
+
+/* If true, malloc_print_stats() and kmem_print_stats() report.
+   Controlled by kernel command-line option "-allocstat". */
+bool alloc_stat_enabled;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void *block_alloc (size_t size);
+static void block_free (void *);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t i, slot = 0;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	lock_init (&big_lock);
+	for (i = 0; i < sizeof class_sizes / sizeof *class_sizes; i++) {
 		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+		d->block_size = class_sizes[i];
+		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / d->block_size;
 		list_init (&d->free_list);
 		lock_init (&d->lock);
+		d->empty_cnt = 0;
+		d->arena_cnt = 0;
+		d->in_use = d->peak = 0;
+		d->alloc_cnt = d->req_bytes = 0;
+
+		ASSERT (d->block_size % 8 == 0);
+		ASSERT (i == 0 || d->block_size > class_sizes[i - 1]);
+		for (; slot * 8 <= d->block_size; slot++)
+			size_to_desc[slot] = i;
 	}
+	ASSERT (slot == sizeof size_to_desc);
+}
+
+/* Obtains and returns a new block of at least SIZE bytes for
+   the caller at SITE.
+   Returns a null pointer if memory is not available. */
+static void *
+malloc_at (size_t size, const void *site) {
+	struct tag_hdr *h;
+
+	if (!memstat_enabled)
+		return block_alloc (size);
+
+	if (size == 0 || size > UINT32_MAX)
+		return NULL;
+	h = block_alloc (size + sizeof *h);
+	if (h == NULL)
+		return NULL;
+	h->size = size;
+	h->tag = memstat_charge (MEMSTAT_MALLOC, site, size);
+	return h + 1;
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	return malloc_at (size, __builtin_return_address (0));
+}
+
+/* Does the work of malloc() without memstat accounting. */
+static void *
+block_alloc (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
@@ -93,10 +186,7 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	if (size > MAX_CLASS_BYTES) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -109,9 +199,15 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+		lock_acquire (&big_lock);
+		big_alloc_cnt++;
+		big_pages += page_cnt;
+		lock_release (&big_lock);
 		return a + 1;
 	}
 
+	d = &descs[size_to_desc[(size + 7) / 8]];
+	ASSERT (d->block_size >= size);
 	lock_acquire (&d->lock);
 
 	/* If the free list is empty, create a new arena. */
@@ -133,12 +229,19 @@ malloc (size_t size) {
 			struct block *b = arena_to_block (a, i);
 			list_push_back (&d->free_list, &b->free_elem);
 		}
+		d->arena_cnt++;
+		d->empty_cnt++;
 	}
 
 	/* Get a block from free list and return it. */
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
-	a->free_cnt--;
+	if (a->free_cnt-- == d->blocks_per_arena)
+		d->empty_cnt--;
+	d->alloc_cnt++;
+	d->req_bytes += size;
+	if (++d->in_use > d->peak)
+		d->peak = d->in_use;
 	lock_release (&d->lock);
 	return b;
 }
@@ -156,7 +259,7 @@ calloc (size_t a, size_t b) {
 		return NULL;
 
 	/* Allocate and zero memory. */
-	p = malloc (size);
+	p = malloc_at (size, __builtin_return_address (0));
 	if (p != NULL)
 		memset (p, 0, size);
 
@@ -167,6 +270,9 @@ calloc (size_t a, size_t b) {
 static size_t
 block_size (void *block) {
 	struct block *b = block;
+
+	if (memstat_enabled)
+		return ((struct tag_hdr *) block - 1)->size;
 	struct arena *a = block_to_arena (b);
 	struct desc *d = a->desc;
 
@@ -185,7 +291,7 @@ realloc (void *old_block, size_t new_size) {
 		free (old_block);
 		return NULL;
 	} else {
-		void *new_block = malloc (new_size);
+		void *new_block = malloc_at (new_size, __builtin_return_address (0));
 		if (old_block != NULL && new_block != NULL) {
 			size_t old_size = block_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
@@ -200,6 +306,18 @@ realloc (void *old_block, size_t new_size) {
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) {
+	if (p != NULL && memstat_enabled) {
+		struct tag_hdr *h = (struct tag_hdr *) p - 1;
+
+		memstat_uncharge (h->tag, h->size);
+		p = h;
+	}
+	block_free (p);
+}
+
+/* Does the work of free() without memstat accounting. */
+static void
+block_free (void *p) {
 	if (p != NULL) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
@@ -217,28 +335,65 @@ free (void *p) {
 
 			/* Add block to free list. */
 			list_push_front (&d->free_list, &b->free_elem);
+			d->in_use--;
 
-			/* If the arena is now entirely unused, free it. */
+			/* If the arena is now entirely unused, keep it unless
+			   we already have enough empty arenas. */
 			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
 				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
+				if (d->empty_cnt < ARENA_CACHE_MAX)
+					d->empty_cnt++;
+				else {
+					size_t i;
+
+					for (i = 0; i < d->blocks_per_arena; i++) {
+						struct block *b = arena_to_block (a, i);
+						list_remove (&b->free_elem);
+					}
+					d->arena_cnt--;
+					palloc_free_page (a);
 				}
-				palloc_free_page (a);
 			}
 
 			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
+			lock_acquire (&big_lock);
+			big_pages -= a->free_cnt;
+			lock_release (&big_lock);
 			palloc_free_multiple (a, a->free_cnt);
 			return;
 		}
 	}
 }
 
+/* Prints per-class allocator statistics.  FRAG is the share of
+   the bytes handed out that callers did not ask for, in percent,
+   and classes that were never used are skipped.  Prints nothing
+   unless alloc_stat_enabled. */
+void
+malloc_print_stats (void) {
+	size_t i;
+
+	if (!alloc_stat_enabled)
+		return;
+
+	for (i = 0; i < desc_cnt; i++) {
+		const struct desc *d = &descs[i];
+		uint64_t given = d->alloc_cnt * d->block_size;
+
+		if (d->alloc_cnt == 0)
+			continue;
+		printf ("Malloc: %4zu B class: %5zu in use (peak %zu), %3zu arenas "
+				"(%zu empty), %llu allocs, %llu%% frag\n",
+				d->block_size, d->in_use, d->peak, d->arena_cnt, d->empty_cnt,
+				(unsigned long long) d->alloc_cnt,
+				(unsigned long long) ((given - d->req_bytes) * 100 / given));
+	}
+	printf ("Malloc: big blocks: %llu allocs, %zu pages in use\n",
+			(unsigned long long) big_alloc_cnt, big_pages);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -0,0 +1,167 @@
+#include "threads/memstat.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/workqueue.h"
+
+/* 커널 메모리 할당 통계.
+ * malloc()과 palloc_get_multiple()은 호출한 함수의 반환 주소(호출 지점)로 할당을 태그한다.
+ * 태그마다 남아 있는 바이트, 그 최댓값, 할당/해제 횟수를 고정 크기 표에 모은다.
+ * 할당 쪽은 태그 번호를 블록 헤더(malloc)나 페이지별 태그 배열(palloc)에 저장해 두고,
+ * 해제할 때 그 번호로 같은 태그에서 바이트를 뺀다.
+ *
+ * 표는 인터럽트를 끄고 다루므로 잠금을 쥔 채로도, 해제 경로 어디에서도 호출할 수 있다.
+ * 호출 지점은 주소로 출력되며, `backtrace kernel.o ADDR...'로 소스 위치를 찾을 수 있다. */
+
+/* 태그 표의 크기. 2의 거듭제곱이어야 한다. */
+#define MEMSTAT_TAGS 256
+
+/* 표가 가득 찼을 때 쓰는 태그. */
+#define TAG_OTHER 0
+
+/* 호출 지점 하나의 통계. */
+struct mem_tag {
+	const void *site;           /* 호출 지점, 비어 있다면 NULL. */
+	enum memstat_kind kind;     /* 할당의 종류. */
+	uint64_t bytes;             /* 해제되지 않은 바이트. */
+	uint64_t peak;              /* bytes의 최댓값. */
+	uint64_t allocs;            /* 할당 횟수. */
+	uint64_t frees;             /* 해제 횟수. */
+};
+
+/* -memstat: 호출 지점별 커널 메모리 사용량을 기록하는가? */
+bool memstat_enabled;
+
+static struct mem_tag tags[MEMSTAT_TAGS];
+
+static const char *kind_names[] = {
+	[MEMSTAT_MALLOC] = "malloc",
+	[MEMSTAT_PALLOC] = "palloc",
+};
+
+static void dump_work_func (struct work *);
+static struct work dump_work;
+
+/* find_tag - KIND 할당의 호출 지점 SITE에 해당하는 태그 번호를 찾고, 없다면 새로 만든다.
+ * 표가 가득 찼다면 TAG_OTHER를 반환한다. 인터럽트가 꺼진 상태에서 호출되어야 한다. */
+static uint16_t
+find_tag (enum memstat_kind kind, const void *site) {
+	size_t h = (((uintptr_t) site >> 2) * 2 + kind) & (MEMSTAT_TAGS - 1);
+
+	for (size_t i = 0; i < MEMSTAT_TAGS; i++) {
+		size_t idx = (h + i) & (MEMSTAT_TAGS - 1);
+		struct mem_tag *t = &tags[idx];
+
+		if (idx == TAG_OTHER)
+			continue;
+		if (t->site == site && t->kind == kind)
+			return idx;
+		if (t->site == NULL) {
+			t->site = site;
+			t->kind = kind;
+			return idx;
+		}
+	}
+	return TAG_OTHER;
+}
+
+/* memstat_charge - 호출 지점 SITE에서 BYTES 바이트를 할당했음을 기록하고 태그 번호를 반환한다.
+ * 반환된 번호는 해제할 때 memstat_uncharge()에 넘겨야 한다. */
+uint16_t
+memstat_charge (enum memstat_kind kind, const void *site, size_t bytes) {
+	enum intr_level old_level = intr_disable ();
+	uint16_t tag = find_tag (kind, site);
+	struct mem_tag *t = &tags[tag];
+
+	t->allocs++;
+	t->bytes += bytes;
+	if (t->bytes > t->peak)
+		t->peak = t->bytes;
+	intr_set_level (old_level);
+	return tag;
+}
+
+/* memstat_uncharge - memstat_charge()가 반환한 TAG에서 BYTES 바이트가 해제되었음을 기록한다. */
+void
+memstat_uncharge (uint16_t tag, size_t bytes) {
+	enum intr_level old_level = intr_disable ();
+	struct mem_tag *t = &tags[tag];
+
+	ASSERT (tag < MEMSTAT_TAGS);
+	ASSERT (t->bytes >= bytes);
+	t->frees++;
+	t->bytes -= bytes;
+	intr_set_level (old_level);
+}
+
+/* memstat_print - -memstat이 켜져 있다면 풀별 빈 페이지 통계와 호출 지점별 통계를 출력한다.
+ * 호출 지점은 남아 있는 바이트가 많은 순서로 출력하며, 할당률은 부팅 이후 초당 평균이다.
+ * 잠금을 얻으므로 인터럽트 핸들러에서 호출해서는 안된다. 키 입력처럼 인터럽트에서 요청할 때는
+ * memstat_request_dump()를 사용하라. */
+void
+memstat_print (void) {
+	static uint16_t order[MEMSTAT_TAGS];
+	size_t cnt = 0;
+	int64_t secs;
+
+	if (!memstat_enabled)
+		return;
+	palloc_print_stats ();
+
+	secs = timer_ticks () / TIMER_FREQ;
+	if (secs == 0)
+		secs = 1;
+
+	/* 삽입 정렬로 남아 있는 바이트의 내림차순 순서를 만든다.
+	   출력 중에 값이 바뀌어도 상관없으므로 인터럽트는 끄지 않는다. */
+	for (size_t i = 0; i < MEMSTAT_TAGS; i++) {
+		size_t j;
+
+		if (tags[i].allocs == 0)
+			continue;
+		for (j = cnt; j > 0 && tags[order[j - 1]].bytes < tags[i].bytes; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+		cnt++;
+	}
+
+	printf ("Memstat: %-6s %-18s %10s %10s %10s %10s %8s\n", "kind", "site",
+			"bytes", "peak", "allocs", "frees", "allocs/s");
+	for (size_t i = 0; i < cnt; i++) {
+		const struct mem_tag *t = &tags[order[i]];
+
+		if (order[i] == TAG_OTHER)
+			printf ("Memstat: %-6s %-18s", "-", "(other)");
+		else
+			printf ("Memstat: %-6s %18p", kind_names[t->kind], t->site);
+		printf (" %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64" %8"PRId64"\n",
+				t->bytes, t->peak, t->allocs, t->frees,
+				(int64_t) t->allocs / secs);
+	}
+	printf ("Memstat: translate sites with `backtrace kernel.o SITE...'.\n");
+}
+
+/* memstat_request_dump - system_wq의 워커가 memstat_print()를 실행하도록 요청한다.
+ * CPU를 양보하지 않으므로 키보드 인터럽트 핸들러에서도 호출할 수 있다.
+ * 워크큐가 아직 만들어지지 않았다면 아무것도 하지 않는다. */
+void
+memstat_request_dump (void) {
+	enum intr_level old_level = intr_disable ();
+
+	if (workqueue_started (&system_wq)) {
+		if (dump_work.func == NULL)
+			work_init (&dump_work, dump_work_func);
+		schedule_work (&dump_work);
+	}
+	intr_set_level (old_level);
+}
+
+/* dump_work_func - memstat_request_dump()가 넣은 작업. */
+static void
+dump_work_func (struct work *work UNUSED) {
+	memstat_print ();
+}
@@ -8,6 +8,34 @@
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Replaces the 2 MiB mapping in page directory entry PDE by a
+ * page table of 4 KiB entries that map the same frames with the
+ * same permissions and accessed/dirty bits.  Returns false if the
+ * page table cannot be allocated. */
+/* 페이지 디렉토리 항목 PDE의 2 MiB 매핑을, 같은 프레임을 같은 권한과 accessed/dirty 비트로 매핑하는
+ * 4 KiB 페이지 테이블로 바꿉니다. 페이지 테이블을 할당할 수 없으면 false를 반환합니다. */
+static bool
+pde_split (uint64_t *pde) {
+	uint64_t flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+	uint64_t *pt = palloc_get_page (0);
+
+	if (pt == NULL)
+		return false;
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		pt[i] = (PTE_ADDR (*pde) + (uint64_t) i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+
+	/* The TLB may still hold the 2 MiB translation. */
+	lcr3 (rcr3 ());
+	return true;
+}
+
+/* For a 2 MiB mapping (PTE_PS), returns the page directory entry
+ * itself unless CREATE is true, in which case the mapping is
+ * first split into 4 KiB entries so that one of them can be
+ * changed. */
+/* 2 MiB 매핑(PTE_PS)이라면, CREATE가 false일 때는 페이지 디렉토리 항목 자체를 반환하고
+ * true일 때는 그중 한 항목을 바꿀 수 있도록 먼저 4 KiB 항목들로 나눕니다. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -23,6 +51,12 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		if ((uint64_t) pte & PTE_PS) {
+			if (!create)
+				return &pdp[idx];
+			if (!pde_split (&pdp[idx]))
+				return NULL;
+		}
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -92,6 +126,30 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the address of the page directory entry for virtual
+ * address VA in PML4, creating the page directory pointer table
+ * and page directory on the way if needed.  Returns a null
+ * pointer if memory allocation fails. */
+/* PML4에서 가상 주소 VA에 대한 페이지 디렉토리 항목의 주소를 반환하며,
+ * 필요하면 도중의 페이지 디렉토리 포인터 테이블과 페이지 디렉토리를 만듭니다.
+ * 메모리 할당에 실패하면 null 포인터를 반환합니다. */
+static uint64_t *
+pde_walk (uint64_t *pml4, const uint64_t va) {
+	uint64_t *table = pml4;
+
+	for (uint64_t shift = PML4SHIFT; shift > PDXSHIFT; shift -= 9) {
+		uint64_t *e = &table[(va >> shift) & 0x1FF];
+		if (!(*e & PTE_P)) {
+			uint64_t *new_page = palloc_get_page (PAL_ZERO);
+			if (new_page == NULL)
+				return NULL;
+			*e = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*e));
+	}
+	return &table[PDX (va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -102,7 +160,7 @@ uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
 	if (pml4)
-		memcpy (pml4, base_pml4, PGSIZE);
+		copy_page (pml4, base_pml4);
 	return pml4;
 }
 
@@ -128,10 +186,18 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
+		if (((uint64_t) pte) & PTE_P) {
+			/* A 2 MiB mapping is passed to FUNC as a single entry. */
+			if (pdp[i] & PTE_PS) {
+				void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+									 ((uint64_t) pdp_index << PDPESHIFT) |
+									 ((uint64_t) i << PDXSHIFT));
+				if (!func (&pdp[i], va, aux))
+					return false;
+			} else if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
+		}
 	}
 	return true;
 }
@@ -176,7 +242,14 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		if (pdp[i] & PTE_PS) {
+			/* Huge frames are allocated as a unit but freed page by page,
+			   since a split mapping releases them one at a time. */
+			for (size_t j = 0; j < HPGSIZE / PGSIZE; j++)
+				palloc_free_page ((void *) (PTE_ADDR (pte) + j * PGSIZE));
+		} else
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -228,8 +301,11 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
-	if (pte && (*pte & PTE_P))
+	if (pte && (*pte & PTE_P)) {
+		if (*pte & PTE_PS)
+			return ptov (PTE_ADDR (*pte)) + ((uint64_t) uaddr & HPGMASK);
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+	}
 	return NULL;
 }
 
@@ -255,20 +331,76 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		/* UPAGE may have been mapped read-only, e.g. for copy-on-write. */
+		if (rcr3 () == vtop (pml4))
+			invlpg ((uint64_t) upage);
+	}
 	return pte != NULL;
 }
 
+/* Maps the 2 MiB user virtual region starting at UPAGE to the
+ * physically contiguous frames starting at KPAGE with a single
+ * page directory entry.  Both must be 2 MiB aligned; KPAGE should
+ * come from palloc_get_aligned (PAL_USER, HPGSIZE / PGSIZE).
+ * No page in the region may be mapped.  Returns true if
+ * successful, false if memory allocation failed or some page in
+ * the region is already mapped. */
+/* UPAGE에서 시작하는 2 MiB 사용자 가상 영역을 KPAGE에서 시작하는 물리적으로 연속된 프레임에
+ * 페이지 디렉토리 항목 하나로 매핑합니다. 둘 다 2 MiB 단위로 정렬되어 있어야 하며, KPAGE는
+ * palloc_get_aligned (PAL_USER, HPGSIZE / PGSIZE)로 얻은 것이어야 합니다.
+ * 영역 안의 어떤 페이지도 매핑되어 있으면 안 됩니다. 성공하면 true, 메모리 할당에 실패했거나
+ * 영역 안에 이미 매핑된 페이지가 있으면 false를 반환합니다. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (((uint64_t) upage & HPGMASK) == 0);
+	ASSERT ((vtop (kpage) & HPGMASK) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pde_walk (pml4, (uint64_t) upage);
+
+	if (pde == NULL)
+		return false;
+	if (*pde & PTE_P) {
+		uint64_t *pt;
+
+		if (*pde & PTE_PS)
+			return false;
+		/* A page table with no present entry may be left over from
+		   pages that were mapped and cleared; drop it. */
+		pt = ptov (PTE_ADDR (*pde));
+		for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+			if (pt[i] & PTE_P)
+				return false;
+		palloc_free_page (pt);
+	}
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	if (rcr3 () == vtop (pml4))
+		invlpg ((uint64_t) upage);
+	return true;
+}
+
+/* Returns true if UPAGE in PML4 is mapped by a 2 MiB page. */
+/* PML4에서 UPAGE가 2 MiB 페이지로 매핑되어 있으면 true를 반환합니다. */
+bool
+pml4_is_huge (uint64_t *pml4, const void *upage) {
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	return pte != NULL && (*pte & PTE_PS) != 0;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
  * UPAGE need not be mapped. */
 /* 사용자 가상 페이지 UPAGE를 페이지 디렉토리 PD에서 "없음"으로 표시합니다.
  * 나중에 페이지에 대한 액세스는 오류가 발생합니다. 페이지 테이블 항목의 다른 비트는 보존됩니다.
- * UPAGE가 매핑되어 있지 않아도 됩니다. */
+ * UPAGE가 매핑되어 있지 않아도 됩니다.
+ * UPAGE가 2 MiB 매핑에 들어 있다면 먼저 나누며, 나눌 페이지 테이블을 할당할 수 없으면
+ * 매핑을 그대로 두고 false를 반환합니다. 그 외에는 true를 반환합니다. */
 
-void
+bool
 pml4_clear_page (uint64_t *pml4, void *upage) {
 	uint64_t *pte;
 	ASSERT (pg_ofs (upage) == 0);
@@ -276,11 +408,19 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
+	/* Only UPAGE goes away, so a 2 MiB mapping is split first. */
+	if (pte != NULL && (*pte & PTE_PS) != 0) {
+		pte = pml4e_walk (pml4, (uint64_t) upage, true);
+		if (pte == NULL)
+			return false;
+	}
+
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
 		if (rcr3 () == vtop (pml4))
 			invlpg ((uint64_t) upage);
 	}
+	return true;
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
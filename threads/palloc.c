@@ -2,13 +2,16 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/memstat.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -26,11 +29,40 @@
    half to the user pool.  That should be huge overkill for the
    kernel pool, but that's just fine for demonstration purposes. */
 
-/* A memory pool. */
+/* 풀마다 미리 0으로 채워 둘 페이지의 최대 수. */
+#define ZEROED_MAX 32
+
+/* 버디 할당자의 order 수. 한 번에 할당할 수 있는 가장 큰 블록은 2^(MAX_ORDER - 1) 페이지(4 MiB)이다. */
+#define MAX_ORDER 11
+
+/* A memory pool.
+ *
+ * 비어 있는 페이지는 이진 버디 할당자로 관리한다.
+ * 2^k 페이지 크기의 블록은 항상 2^k 페이지 단위로 정렬되어 있으며, free_lists[k]에 들어 있다.
+ * base는 가장 큰 블록 크기에 맞추어 물리 주소가 정렬되도록 풀의 실제 시작보다 pad_cnt 페이지 앞에 두고,
+ * 그 페이지들은 사용 중으로 표시한다. 따라서 블록의 인덱스 정렬은 곧 물리 주소 정렬이다.
+ * 비어 있는 블록의 첫 페이지에는 struct free_block을 두어 리스트를 잇고 블록의 order를 기록한다.
+ * used_map은 페이지가 사용 중인지를 나타내며 소유 검사(ASSERT)와 버디가 비어 있는지 확인하는 데 쓴다.
+ * 모든 비어 있는 페이지는 어떤 비어 있는 블록에 속하므로, 정렬된 인덱스 b의 페이지가 비어 있다면
+ * b는 반드시 어떤 비어 있는 블록의 첫 페이지이다. */
 struct pool {
+	const char *name;               /* 통계 출력에 쓰는 이름. */
 	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct bitmap *used_map;        /* Bitmap of used pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t pad_cnt;                 /* base 정렬을 위해 앞에 덧붙인 페이지 수. */
+	struct list free_lists[MAX_ORDER]; /* order별 비어 있는 블록 리스트. */
+	size_t free_cnt;                /* free_lists에 있는 페이지 수. */
+
+	/* Idle 스레드가 미리 0으로 채워 둔 페이지들.
+	   used_map에서는 사용 중으로 표시되며, 각 페이지의 맨 앞에 list_elem을 둔다.
+	   인터럽트를 끄고 다룬다. */
+	struct list zeroed;
+	size_t zeroed_cnt;
+
+	/* -memstat: 할당된 블록의 첫 페이지마다 호출 지점의 memstat 태그를 기록한다.
+	   memstat_enabled가 아니라면 NULL. */
+	uint16_t *tags;
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,9 +71,22 @@ static struct pool kernel_pool, user_pool;
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
 static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
+init_pool (struct pool *p, const char *name, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void *zeroed_take (struct pool *);
+static bool zeroed_refill (struct pool *);
+static bool zeroed_drain (struct pool *);
+static void buddy_init (struct pool *);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void *get_pages (enum palloc_flags, size_t page_cnt, const void *site);
+
+/* 비어 있는 버디 블록의 첫 페이지에 두는 헤더. */
+struct free_block {
+	struct list_elem elem;          /* free_lists[order]의 원소. */
+	unsigned order;                 /* 블록의 크기는 2^order 페이지. */
+};
 
 /* multiboot info */
 struct multiboot_info {
@@ -158,7 +203,7 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 						break;
 					}
 					// generate kernel pool
-					init_pool (&kernel_pool,
+					init_pool (&kernel_pool, "kernel_pool",
 							&free_start, region_start, start + rem * PGSIZE);
 					// Transition to the next state
 					if (rem == size_in_pg) {
@@ -188,7 +233,7 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 	}
 
 	// generate the user pool
-	init_pool(&user_pool, &free_start, region_start, end);
+	init_pool(&user_pool, "user_pool", &free_start, region_start, end);
 
 	// Iterate over the e820_entry. Setup the usable.
 	uint64_t usable_bound = (uint64_t) free_start;
@@ -232,6 +277,9 @@ split:
 			}
 		}
 	}
+
+	buddy_init (&kernel_pool);
+	buddy_init (&user_pool);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -268,26 +316,46 @@ palloc_init (void) {
    이 경우 커널이 패닉합니다. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
-	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
-
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	return get_pages (flags, page_cnt, __builtin_return_address (0));
+}
 
-	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
-	} else {
-		if (flags & PAL_ASSERT)
-			PANIC ("palloc_get: out of pages");
+/* get_pages - palloc_get_multiple()과 같지만, -memstat이 켜져 있다면 할당을 호출 지점 SITE에 기록한다. */
+static void *
+get_pages (enum palloc_flags flags, size_t page_cnt, const void *site) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages = NULL;
+
+	/* 한 페이지짜리 PAL_ZERO 요청은 미리 0으로 채워 둔 페이지로 먼저 처리한다. */
+	if (page_cnt == 1 && (flags & PAL_ZERO))
+		pages = zeroed_take (pool);
+
+	if (pages == NULL) {
+		size_t page_idx;
+
+		/* 여러 페이지 요청이 실패했다면 미리 0으로 채워 둔 페이지를 버디에 돌려주어 합친 뒤 다시 시도한다. */
+		lock_acquire (&pool->lock);
+		do
+			page_idx = buddy_alloc (pool, page_cnt);
+		while (page_idx == BITMAP_ERROR && page_cnt > 1 && zeroed_drain (pool));
+		lock_release (&pool->lock);
+
+		if (page_idx != BITMAP_ERROR) {
+			pages = pool->base + PGSIZE * page_idx;
+			if (flags & PAL_ZERO)
+				for (size_t i = 0; i < page_cnt; i++)
+					clear_page (pages + PGSIZE * i);
+		} else if (page_cnt == 1) {
+			/* 비어 있는 페이지가 없다면 미리 0으로 채워 둔 페이지도 내어 준다. */
+			pages = zeroed_take (pool);
+		}
 	}
 
+	if (pages == NULL && (flags & PAL_ASSERT))
+		PANIC ("palloc_get: out of pages");
+
+	if (pages != NULL && pool->tags != NULL)
+		pool->tags[pg_no (pages) - pg_no (pool->base)]
+			= memstat_charge (MEMSTAT_PALLOC, site, PGSIZE * page_cnt);
 	return pages;
 }
 
@@ -307,7 +375,44 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
    이 경우 커널이 패닉합니다. */  
 void *
 palloc_get_page (enum palloc_flags flags) {
-	return palloc_get_multiple (flags, 1);
+	return get_pages (flags, 1, __builtin_return_address (0));
+}
+
+/* palloc_get_aligned - 물리 주소가 PAGE_CNT 페이지 단위로 정렬된 연속 PAGE_CNT 페이지를 얻어 반환한다.
+ * PAGE_CNT는 가장 큰 버디 블록 이하의 2의 거듭제곱이어야 하며, 2 MiB 큰 페이지처럼 하드웨어가 물리 정렬을
+ * 요구하는 매핑에 쓴다. 버디 블록은 물리 주소로도 정렬되어 있으므로 같은 크기의 블록 하나면 된다.
+ * FLAGS는 palloc_get_multiple()과 같다.
+ * 나중에 한 장씩 나누어 해제할 수 있도록 -memstat은 페이지마다 따로 기록하므로,
+ * 반환된 페이지는 palloc_free_page()로 한 장씩 해제해야 한다. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t page_idx;
+	void *pages = NULL;
+
+	ASSERT (page_cnt > 0 && (page_cnt & (page_cnt - 1)) == 0);
+	ASSERT (page_cnt <= (size_t) 1 << (MAX_ORDER - 1));
+
+	lock_acquire (&pool->lock);
+	do
+		page_idx = buddy_alloc (pool, page_cnt);
+	while (page_idx == BITMAP_ERROR && zeroed_drain (pool));
+	lock_release (&pool->lock);
+
+	if (page_idx != BITMAP_ERROR) {
+		pages = pool->base + PGSIZE * page_idx;
+		if (flags & PAL_ZERO)
+			for (size_t i = 0; i < page_cnt; i++)
+				clear_page (pages + PGSIZE * i);
+		if (pool->tags != NULL) {
+			const void *site = __builtin_return_address (0);
+
+			for (size_t i = 0; i < page_cnt; i++)
+				pool->tags[page_idx + i] = memstat_charge (MEMSTAT_PALLOC, site, PGSIZE);
+		}
+	} else if (flags & PAL_ASSERT)
+		PANIC ("palloc_get: out of pages");
+	return pages;
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
@@ -328,12 +433,16 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 		NOT_REACHED ();
 
 	page_idx = pg_no (pages) - pg_no (pool->base);
+	if (pool->tags != NULL)
+		memstat_uncharge (pool->tags[page_idx], PGSIZE * page_cnt);
 
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	lock_acquire (&pool->lock);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free (pool, page_idx, page_cnt);
+	lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -342,23 +451,332 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END */
+/* copy_page - 페이지 SRC의 내용을 페이지 DST로 복사한다. 둘 다 페이지 경계에 정렬되어 있어야 한다.
+ * 크기와 정렬이 정해져 있으므로 memcpy()의 경계 처리 없이 `rep movsq' 한 번으로 옮긴다. */
+void
+copy_page (void *dst, const void *src) {
+	size_t words = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (dst) == 0 && pg_ofs (src) == 0);
+	asm volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+}
+
+/* clear_page - 페이지 PAGE를 0으로 채운다. PAGE는 페이지 경계에 정렬되어 있어야 한다. */
+void
+clear_page (void *page) {
+	size_t words = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (page) == 0);
+	asm volatile ("rep stosq"
+			: "+D" (page), "+c" (words) : "a" (0) : "memory");
+}
+
+/* palloc_page_cnt - FLAGS가 가리키는 풀(PAL_USER라면 사용자 풀, 아니면 커널 풀)의 전체 페이지 수를 반환한다. */
+size_t
+palloc_page_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+	return bitmap_size (pool->used_map) - pool->pad_cnt;
+}
+
+/* palloc_free_cnt - FLAGS가 가리키는 풀에 남은 빈 페이지 수를 반환한다.
+ * 미리 0으로 채워 둔 페이지도 빈 페이지로 센다. 페이지 폴트마다 불리므로 used_map을 훑지 않고
+ * 버디 할당자가 유지하는 free_cnt를 잠금 없이 읽는다. 따라서 이미 달라져 있을 수 있는 근삿값이다. */
+size_t
+palloc_free_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+	return pool->free_cnt + pool->zeroed_cnt;
+}
+
+/* print_pool_stats - POOL의 빈 페이지 수와 가장 긴 연속된 빈 구간의 길이를 출력한다.
+ * 미리 0으로 채워 둔 페이지는 used_map에서 사용 중이므로 따로 센다. */
 static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
+print_pool_stats (struct pool *pool) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+	size_t free_cnt = 0, largest = 0, idx = 0;
+	unsigned order, max_order = 0;
+
+	lock_acquire (&pool->lock);
+	while (idx < page_cnt) {
+		size_t start = bitmap_scan (pool->used_map, idx, 1, false);
+		size_t end;
+
+		if (start == BITMAP_ERROR)
+			break;
+		end = bitmap_scan (pool->used_map, start, 1, true);
+		if (end == BITMAP_ERROR)
+			end = page_cnt;
+		free_cnt += end - start;
+		if (end - start > largest)
+			largest = end - start;
+		idx = end;
+	}
+	for (order = 0; order < MAX_ORDER; order++)
+		if (!list_empty (&pool->free_lists[order]))
+			max_order = order;
+	lock_release (&pool->lock);
+
+	printf ("Pool %s: %zu pages, %zu free (+%zu pre-zeroed), "
+			"largest free run %zu pages, largest free block %zu pages\n",
+			pool->name, page_cnt - pool->pad_cnt, free_cnt, pool->zeroed_cnt, largest,
+			free_cnt > 0 ? (size_t) 1 << max_order : 0);
+}
+
+/* palloc_print_stats - 두 풀의 빈 페이지 통계를 출력한다. 사용자 풀의 크기(-ul)를 정하는 데 쓴다. */
+void
+palloc_print_stats (void) {
+	print_pool_stats (&kernel_pool);
+	print_pool_stats (&user_pool);
+}
+
+/* palloc_zero_idle - 비어 있는 페이지 하나를 0으로 채워 미리 0으로 채운 페이지 목록에 넣는다.
+ * Idle 스레드가 할 일이 없을 때 호출하며, 페이지 하나를 채웠다면 true를 반환한다.
+ * 두 풀의 목록이 모두 가득 찼거나 채울 페이지가 없다면 false를 반환한다.
+ * Idle 스레드는 잠들 수 없으므로 풀의 잠금은 lock_try_acquire()로만 얻는다.
+ */
+bool
+palloc_zero_idle (void) {
+	return zeroed_refill (&user_pool) || zeroed_refill (&kernel_pool);
+}
+
+/* zeroed_take - POOL의 미리 0으로 채워 둔 페이지를 하나 꺼내 반환한다. 없다면 NULL을 반환한다. */
+static void *
+zeroed_take (struct pool *pool) {
+	enum intr_level old_level = intr_disable ();
+	struct list_elem *e = NULL;
+
+	if (!list_empty (&pool->zeroed)) {
+		e = list_pop_front (&pool->zeroed);
+		pool->zeroed_cnt--;
+	}
+	intr_set_level (old_level);
+
+	if (e == NULL)
+		return NULL;
+	/* 목록을 위해 페이지 맨 앞에 두었던 list_elem만 다시 지운다. */
+	memset (e, 0, sizeof *e);
+	return e;
+}
+
+/* zeroed_refill - POOL의 목록이 가득 차지 않았다면 비어 있는 페이지 하나를 0으로 채워 넣는다.
+ * 페이지를 넣었다면 true를 반환한다. */
+static bool
+zeroed_refill (struct pool *pool) {
+	enum intr_level old_level;
+	size_t page_idx = BITMAP_ERROR;
+	struct list_elem *e;
+
+	if (pool->zeroed_cnt >= ZEROED_MAX)
+		return false;
+
+	/* 잠금을 쥔 채로 선점되어 다른 스레드를 굶기지 않도록 인터럽트를 끄고 짧게 잡는다. */
+	old_level = intr_disable ();
+	if (lock_try_acquire (&pool->lock)) {
+		page_idx = buddy_alloc (pool, 1);
+		lock_release (&pool->lock);
+	}
+	intr_set_level (old_level);
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	e = (struct list_elem *) (pool->base + PGSIZE * page_idx);
+	clear_page (e);
+
+	old_level = intr_disable ();
+	list_push_back (&pool->zeroed, e);
+	pool->zeroed_cnt++;
+	intr_set_level (old_level);
+	return true;
+}
+
+/* zeroed_drain - POOL의 미리 0으로 채워 둔 페이지를 모두 버디 할당자에 돌려준다.
+ * 이 페이지들은 used_map에서 사용 중이므로 이웃 블록이 합쳐지지 못하게 막는다.
+ * 여러 페이지나 정렬된 블록을 할당하지 못했을 때 호출하며, 돌려준 페이지가 있다면 true를 반환한다.
+ * POOL의 잠금을 쥔 상태에서 호출되어야 한다. */
+static bool
+zeroed_drain (struct pool *pool) {
+	bool drained = false;
+
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		struct list_elem *e = NULL;
+
+		if (!list_empty (&pool->zeroed)) {
+			e = list_pop_front (&pool->zeroed);
+			pool->zeroed_cnt--;
+		}
+		intr_set_level (old_level);
+
+		if (e == NULL)
+			return drained;
+		buddy_free (pool, pg_no (e) - pg_no (pool->base), 1);
+		drained = true;
+	}
+}
+
+/* block_at - POOL의 IDX번째 페이지에 있는 버디 블록 헤더를 반환한다. */
+static inline struct free_block *
+block_at (struct pool *pool, size_t idx) {
+	return (struct free_block *) (pool->base + PGSIZE * idx);
+}
+
+/* block_insert - IDX에서 시작하는 2^ORDER 페이지를 비어 있는 블록으로 free_lists에 넣는다.
+ * 블록의 페이지들은 used_map에서 이미 비어 있는 것으로 표시되어 있어야 한다. */
+static void
+block_insert (struct pool *pool, size_t idx, unsigned order) {
+	struct free_block *b = block_at (pool, idx);
+
+	b->order = order;
+	list_push_front (&pool->free_lists[order], &b->elem);
+}
+
+/* largest_order - IDX에서 시작해 CNT 페이지를 넘지 않는, 가장 큰 정렬된 블록의 order를 반환한다. */
+static unsigned
+largest_order (size_t idx, size_t cnt) {
+	unsigned order = 0;
+
+	while (order + 1 < MAX_ORDER
+			&& idx % ((size_t) 2 << order) == 0
+			&& ((size_t) 2 << order) <= cnt)
+		order++;
+	return order;
+}
+
+/* buddy_init - populate_pools()가 만든 used_map으로부터 POOL의 free_lists를 만든다.
+ * 비어 있는 구간마다 가장 큰 정렬된 블록들로 나누어 넣는다.
+ * 구간 사이는 사용 중인 페이지로 나뉘어 있으므로 합칠 수 있는 버디 쌍은 생기지 않는다. */
+static void
+buddy_init (struct pool *pool) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+	size_t idx = 0;
+
+	for (unsigned order = 0; order < MAX_ORDER; order++)
+		list_init (&pool->free_lists[order]);
+	pool->free_cnt = 0;
+
+	while (idx < page_cnt) {
+		size_t start = bitmap_scan (pool->used_map, idx, 1, false);
+		size_t end;
+
+		if (start == BITMAP_ERROR)
+			break;
+		end = bitmap_scan (pool->used_map, start, 1, true);
+		if (end == BITMAP_ERROR)
+			end = page_cnt;
+
+		pool->free_cnt += end - start;
+		for (idx = start; idx < end; ) {
+			unsigned order = largest_order (idx, end - idx);
+			block_insert (pool, idx, order);
+			idx += (size_t) 1 << order;
+		}
+	}
+}
+
+/* buddy_alloc - POOL에서 연속된 PAGE_CNT 페이지를 할당하고 첫 페이지의 인덱스를 반환한다.
+ * PAGE_CNT 이상인 가장 작은 2^k 블록을 찾아, 필요하면 큰 블록을 반으로 나누어 가며 만든다.
+ * 2^k 중 PAGE_CNT를 넘는 뒷부분은 곧바로 돌려준다. 할당할 수 없다면 BITMAP_ERROR를 반환한다.
+ * POOL의 잠금을 쥔 상태에서 호출되어야 한다. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	unsigned want = 0, order;
+	struct free_block *b;
+	size_t idx;
+
+	while (((size_t) 1 << want) < page_cnt)
+		if (++want >= MAX_ORDER)
+			return BITMAP_ERROR;
+
+	for (order = want; order < MAX_ORDER; order++)
+		if (!list_empty (&pool->free_lists[order]))
+			break;
+	if (order >= MAX_ORDER)
+		return BITMAP_ERROR;
+
+	b = list_entry (list_pop_front (&pool->free_lists[order]), struct free_block, elem);
+	idx = pg_no (b) - pg_no (pool->base);
+
+	/* 원하는 크기가 될 때까지 반으로 나누고 뒤쪽 절반은 비어 있는 블록으로 남긴다. */
+	while (order > want) {
+		order--;
+		block_insert (pool, idx + ((size_t) 1 << order), order);
+	}
+
+	bitmap_set_multiple (pool->used_map, idx, page_cnt, true);
+	pool->free_cnt -= (size_t) 1 << want;
+	if (page_cnt < ((size_t) 1 << want))
+		buddy_free (pool, idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+	return idx;
+}
+
+/* buddy_free - POOL의 PAGE_IDX부터 PAGE_CNT 페이지를 돌려준다.
+ * 구간을 정렬된 블록들로 나누고, 각 블록은 버디가 같은 order의 비어 있는 블록인 동안 합쳐 올라간다.
+ * used_map은 블록을 넣을 때마다 비우므로, 아직 넣지 않은 페이지를 버디로 오인하지 않는다.
+ * POOL의 잠금을 쥔 상태에서 호출되어야 한다. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t pool_pages = bitmap_size (pool->used_map);
+	size_t end = page_idx + page_cnt;
+
+	pool->free_cnt += page_cnt;
+	while (page_idx < end) {
+		unsigned order = largest_order (page_idx, end - page_idx);
+		size_t idx = page_idx;
+
+		bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << order, false);
+		page_idx += (size_t) 1 << order;
+
+		while (order + 1 < MAX_ORDER) {
+			size_t buddy = idx ^ ((size_t) 1 << order);
+			struct free_block *b;
+
+			if (buddy + ((size_t) 1 << order) > pool_pages
+					|| bitmap_test (pool->used_map, buddy))
+				break;
+			b = block_at (pool, buddy);
+			if (b->order != order)
+				break;
+			list_remove (&b->elem);
+			idx &= ~((size_t) 1 << order);
+			order++;
+		}
+		block_insert (pool, idx, order);
+	}
+}
+
+/* Initializes pool P, named NAME, as starting at START and ending at END */
+static void
+init_pool (struct pool *p, const char *name, void **bm_base, uint64_t start, uint64_t end) {
   /* We'll put the pool's used_map at its base.
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
-	uint64_t pgcnt = (end - start) / PGSIZE;
+	/* 버디 인덱스가 물리 프레임 번호와 같은 정렬을 갖도록, 가장 큰 블록 크기에 맞추어
+	   시작을 내림한 만큼 앞에 사용 중인 페이지를 덧붙인다. */
+	size_t pad_cnt = pg_no (vtop ((void *) start)) & (((size_t) 1 << (MAX_ORDER - 1)) - 1);
+	uint64_t pgcnt = (end - start) / PGSIZE + pad_cnt;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
 
-	lock_init(&p->lock);
+	p->name = name;
+	lock_init_named(&p->lock, name);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
-	p->base = (void *) start;
+	p->base = (void *) (start - pad_cnt * PGSIZE);
+	p->pad_cnt = pad_cnt;
+	list_init (&p->zeroed);
+	p->zeroed_cnt = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
 
 	*bm_base += bm_pages;
+
+	/* -memstat이라면 페이지별 태그 배열을 비트맵 바로 뒤에 둔다. */
+	p->tags = NULL;
+	if (memstat_enabled) {
+		p->tags = *bm_base;
+		*bm_base += ROUND_UP (pgcnt * sizeof *p->tags, PGSIZE);
+	}
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -366,7 +784,7 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
-	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t start_page = pg_no (pool->base) + pool->pad_cnt;
+	size_t end_page = pg_no (pool->base) + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
@@ -0,0 +1,78 @@
+#include "threads/sched-trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+
+/* 스케줄러 이벤트 트레이스.
+ * 부팅 이후의 스케줄러 이벤트를 고정 크기의 링 버퍼에 기록한다.
+ * 기록할 칸은 trace_head를 원자적으로 증가시켜 얻으므로 잠금 없이 인터럽트 핸들러에서도 기록할 수 있다.
+ * 버퍼가 가득 차면 가장 오래된 이벤트부터 덮어쓴다.
+ *
+ * 덤프 형식은 한 줄에 이벤트 하나이며, utils/sched-latency가 이를 읽어
+ * 우선순위별 wakeup-to-run 지연 시간 히스토그램을 만든다. */
+
+/* 링 버퍼에 보관하는 이벤트 수. 2의 거듭제곱이어야 한다. */
+#define TRACE_SIZE 4096
+
+/* 기록된 이벤트 하나. */
+struct sched_record {
+	int64_t ns;                 /* timer_ns() 타임스탬프. */
+	int32_t tid;                /* 이벤트의 대상 스레드. */
+	int32_t arg;                /* 이벤트별 인자. */
+	uint8_t event;              /* enum sched_event. */
+	uint8_t priority;           /* 이벤트 시점의 우선순위. */
+};
+
+/* -trace: 스케줄러 이벤트를 기록하는가? */
+bool sched_trace_enabled;
+
+static struct sched_record trace_buf[TRACE_SIZE];
+static uint64_t trace_head;     /* 지금까지 기록된 이벤트 수. */
+
+static const char *event_names[SCHED_EVENT_CNT] = {
+	[SCHED_WAKEUP] = "wakeup",
+	[SCHED_SWITCH_IN] = "switch-in",
+	[SCHED_SWITCH_OUT] = "switch-out",
+	[SCHED_BLOCK] = "block",
+	[SCHED_DONATE] = "donate",
+	[SCHED_EXIT] = "exit",
+};
+
+/* sched_trace_record - 스레드 T에 대한 EVENT를 ARG와 함께 링 버퍼에 기록한다.
+ * 인터럽트 핸들러를 포함한 어떤 컨텍스트에서도 호출할 수 있다.
+ */
+void
+sched_trace_record (enum sched_event event, const struct thread *t, int arg) {
+	uint64_t idx;
+	struct sched_record *r;
+
+	ASSERT (event < SCHED_EVENT_CNT);
+	ASSERT (t != NULL);
+
+	idx = __atomic_fetch_add (&trace_head, 1, __ATOMIC_RELAXED);
+	r = &trace_buf[idx & (TRACE_SIZE - 1)];
+	r->ns = timer_ns ();
+	r->tid = t->tid;
+	r->arg = arg;
+	r->event = event;
+	r->priority = t->priority;
+}
+
+/* sched_trace_dump - 링 버퍼에 남아있는 이벤트를 오래된 것부터 콘솔(시리얼)로 출력한다.
+ */
+void
+sched_trace_dump (void) {
+	uint64_t head = __atomic_load_n (&trace_head, __ATOMIC_ACQUIRE);
+	uint64_t first = head > TRACE_SIZE ? head - TRACE_SIZE : 0;
+
+	printf ("Scheduler trace: %"PRIu64" events, %"PRIu64" dropped\n",
+			head - first, first);
+	for (uint64_t i = first; i < head; i++) {
+		const struct sched_record *r = &trace_buf[i & (TRACE_SIZE - 1)];
+		printf ("T %"PRId64" %s %d %d %d\n", r->ns, event_names[r->event],
+				r->tid, r->priority, r->arg);
+	}
+	printf ("Scheduler trace end\n");
+}
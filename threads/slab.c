@@ -0,0 +1,255 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* 슬랩 할당자.
+ * 자주 만들고 없애는 커널 객체(struct page, struct frame, struct inode 등)를 크기별 캐시로 관리한다.
+ * malloc()은 요청을 2의 거듭제곱 크기로 올려 잡으므로 200바이트짜리 객체도 256바이트를 차지하지만,
+ * 캐시는 객체 크기 그대로 페이지를 나누어 쓴다.
+ *
+ * 슬랩은 페이지 하나이며, 페이지 앞쪽에 struct slab을 두고 나머지를 객체로 채운다.
+ * 슬랩의 빈 객체들은 객체 안의 한 워드를 next 포인터로 쓰는 단일 연결 리스트로 잇는다.
+ * 생성자가 있는 캐시는 생성자가 만든 내용을 덮어쓰지 않도록 객체 뒤에 워드 하나를 덧붙여 거기에 둔다.
+ * 객체가 어느 슬랩에 속하는지는 주소를 페이지 경계로 내려 알 수 있다.
+ *
+ * 모든 객체가 비게 된 슬랩은 페이지 할당자에 돌려주되, 빈 객체가 남은 유일한 슬랩이라면
+ * 할당과 해제가 번갈아 일어날 때 페이지를 반복해서 얻고 돌려주지 않도록 남겨 둔다. */
+
+/* 슬랩 손상을 감지하기 위한 매직 넘버. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* 슬랩 헤더. 슬랩 페이지의 맨 앞에 놓인다. */
+struct slab {
+	unsigned magic;                     /* 항상 SLAB_MAGIC. */
+	struct kmem_cache *cache;           /* 이 슬랩을 가진 캐시. */
+	struct list_elem elem;              /* 캐시의 partial 또는 full 리스트 원소. */
+	size_t free_cnt;                    /* 빈 객체 수. */
+	void *free;                         /* 첫 번째 빈 객체. */
+};
+
+/* 슬랩 안 첫 객체의 오프셋. */
+#define SLAB_OBJ_OFS ROUND_UP (sizeof (struct slab), sizeof (void *))
+
+/* 빈 객체 OBJ의 next 포인터. */
+#define FREE_NEXT(CACHE, OBJ) (*(void **)((uint8_t *)(OBJ) + (CACHE)->free_ofs))
+
+/* kmem_cache_create()로 만든 모든 캐시. */
+static struct list cache_list;
+
+static struct slab *slab_create (struct kmem_cache *);
+static void slab_destroy (struct kmem_cache *, struct slab *);
+static struct slab *obj_to_slab (void *obj);
+
+/* slab_init - 슬랩 할당자를 초기화한다. kmem_cache_create()보다 먼저 호출되어야 한다.
+ */
+void slab_init(void)
+{
+	list_init(&cache_list);
+}
+
+/* kmem_cache_create - cache를 size바이트 객체를 위한 빈 캐시로 초기화한다.
+ * ctor가 NULL이 아니라면 슬랩을 새로 만들 때 그 안의 객체마다 한 번씩 호출된다.
+ * 따라서 캐시에 돌려주는 객체는 생성자가 만든 상태로 되돌려 놓아야 한다.
+ */
+void kmem_cache_create(struct kmem_cache *cache, const char *name, size_t size, kmem_ctor_func *ctor)
+{
+	ASSERT(cache != NULL);
+	ASSERT(size > 0);
+
+	if (size < sizeof(void *))
+		size = sizeof(void *);
+	size = ROUND_UP(size, sizeof(void *));
+	cache->free_ofs = 0;
+	if (ctor != NULL)
+	{
+		cache->free_ofs = size;
+		size += sizeof(void *);
+	}
+	ASSERT(size <= PGSIZE - SLAB_OBJ_OFS);
+
+	cache->name = name;
+	cache->obj_size = size;
+	cache->objs_per_slab = (PGSIZE - SLAB_OBJ_OFS) / size;
+	cache->ctor = ctor;
+	lock_init(&cache->lock);
+	list_init(&cache->partial);
+	list_init(&cache->full);
+	cache->slab_cnt = 0;
+	cache->in_use = 0;
+	cache->peak = 0;
+	cache->alloc_cnt = 0;
+	cache->free_cnt = 0;
+	list_push_back(&cache_list, &cache->elem);
+}
+
+/* kmem_cache_alloc - cache에서 객체 하나를 할당해 반환한다. 메모리가 없다면 NULL을 반환한다.
+ * 생성자가 있다면 반환된 객체는 생성자가 만든 상태이다.
+ */
+void *kmem_cache_alloc(struct kmem_cache *cache)
+{
+	struct slab *slab;
+	void *obj;
+
+	ASSERT(cache != NULL);
+
+	lock_acquire(&cache->lock);
+	if (list_empty(&cache->partial))
+	{
+		slab = slab_create(cache);
+		if (slab == NULL)
+		{
+			lock_release(&cache->lock);
+			return NULL;
+		}
+		list_push_back(&cache->partial, &slab->elem);
+	}
+	else
+		slab = list_entry(list_front(&cache->partial), struct slab, elem);
+
+	obj = slab->free;
+	slab->free = FREE_NEXT(cache, obj);
+	if (--slab->free_cnt == 0)
+	{
+		list_remove(&slab->elem);
+		list_push_back(&cache->full, &slab->elem);
+	}
+
+	cache->alloc_cnt++;
+	if (++cache->in_use > cache->peak)
+		cache->peak = cache->in_use;
+	lock_release(&cache->lock);
+	return obj;
+}
+
+/* kmem_cache_zalloc - kmem_cache_alloc()과 같지만 반환하는 객체를 0으로 채운다.
+ */
+void *kmem_cache_zalloc(struct kmem_cache *cache)
+{
+	void *obj = kmem_cache_alloc(cache);
+
+	if (obj != NULL)
+		memset(obj, 0, cache->obj_size);
+	return obj;
+}
+
+/* kmem_cache_free - cache에서 할당한 obj를 돌려준다. obj가 NULL이라면 아무것도 하지 않는다.
+ */
+void kmem_cache_free(struct kmem_cache *cache, void *obj)
+{
+	struct slab *slab;
+
+	ASSERT(cache != NULL);
+
+	if (obj == NULL)
+		return;
+
+	slab = obj_to_slab(obj);
+	ASSERT(slab->cache == cache);
+	ASSERT(((uint8_t *)obj - ((uint8_t *)slab + SLAB_OBJ_OFS)) % cache->obj_size == 0);
+
+	lock_acquire(&cache->lock);
+	FREE_NEXT(cache, obj) = slab->free;
+	slab->free = obj;
+	if (slab->free_cnt++ == 0)
+	{
+		/* 가득 찼던 슬랩에 빈 객체가 생겼다. */
+		list_remove(&slab->elem);
+		list_push_front(&cache->partial, &slab->elem);
+	}
+	if (slab->free_cnt == cache->objs_per_slab)
+	{
+		/* 완전히 빈 슬랩은 빈 객체가 남은 다른 슬랩이 있을 때만 돌려준다. */
+		list_remove(&slab->elem);
+		if (list_empty(&cache->partial))
+			list_push_back(&cache->partial, &slab->elem);
+		else
+			slab_destroy(cache, slab);
+	}
+
+	cache->free_cnt++;
+	cache->in_use--;
+	lock_release(&cache->lock);
+}
+
+/* kmem_print_stats - 모든 캐시의 사용량 통계를 출력한다.
+ * 사용 중인 객체가 차지하는 바이트와 슬랩 페이지 전체 바이트의 비율을 효율(%)로 함께 출력한다.
+ * -allocstat 옵션이 꺼져 있다면 아무것도 하지 않는다.
+ */
+void kmem_print_stats(void)
+{
+	struct list_elem *e;
+
+	if (!alloc_stat_enabled)
+		return;
+
+	for (e = list_begin(&cache_list); e != list_end(&cache_list); e = list_next(e))
+	{
+		const struct kmem_cache *c = list_entry(e, struct kmem_cache, elem);
+		size_t bytes = c->slab_cnt * PGSIZE;
+
+		printf("Slab: %-14s %5zu B/obj, %5zu in use (peak %zu), %3zu slabs, "
+			   "%llu allocs, %llu frees, %3zu%% efficiency\n",
+			   c->name, c->obj_size, c->in_use, c->peak, c->slab_cnt,
+			   (unsigned long long)c->alloc_cnt, (unsigned long long)c->free_cnt,
+			   bytes > 0 ? c->in_use * c->obj_size * 100 / bytes : 0);
+	}
+}
+
+/* slab_create - cache를 위한 새 슬랩을 만들어 반환한다. 페이지를 얻을 수 없다면 NULL을 반환한다.
+ * 모든 객체는 빈 객체 리스트에 들어가며, 생성자가 있다면 객체마다 호출한다.
+ * cache의 잠금을 쥔 상태에서 호출되어야 한다.
+ */
+static struct slab *slab_create(struct kmem_cache *cache)
+{
+	struct slab *slab = palloc_get_page(0);
+	uint8_t *obj;
+	size_t i;
+
+	if (slab == NULL)
+		return NULL;
+
+	slab->magic = SLAB_MAGIC;
+	slab->cache = cache;
+	slab->free_cnt = cache->objs_per_slab;
+	slab->free = NULL;
+
+	/* 주소가 낮은 객체부터 나가도록 뒤에서부터 리스트에 넣는다. */
+	obj = (uint8_t *)slab + SLAB_OBJ_OFS + cache->obj_size * cache->objs_per_slab;
+	for (i = 0; i < cache->objs_per_slab; i++)
+	{
+		obj -= cache->obj_size;
+		if (cache->ctor != NULL)
+			cache->ctor(obj);
+		FREE_NEXT(cache, obj) = slab->free;
+		slab->free = obj;
+	}
+	cache->slab_cnt++;
+	return slab;
+}
+
+/* slab_destroy - 모든 객체가 빈 slab을 페이지 할당자에 돌려준다.
+ * cache의 잠금을 쥔 상태에서 호출되어야 한다.
+ */
+static void slab_destroy(struct kmem_cache *cache, struct slab *slab)
+{
+	ASSERT(slab->free_cnt == cache->objs_per_slab);
+
+	slab->magic = 0;
+	cache->slab_cnt--;
+	palloc_free_page(slab);
+}
+
+/* obj_to_slab - obj가 들어 있는 슬랩의 헤더를 반환한다.
+ */
+static struct slab *obj_to_slab(void *obj)
+{
+	struct slab *slab = pg_round_down(obj);
+
+	ASSERT(slab->magic == SLAB_MAGIC);
+	return slab;
+}
@@ -31,10 +31,29 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/sched-trace.h"
+#include "devices/timer.h"
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
+/* 대기 순번. 같은 우선순위의 대기자는 먼저 기다리기 시작한 쪽이 먼저 깨어난다. */
+static uint64_t wait_seq;
+
+static bool waiter_less (const struct heap_elem *a, const struct heap_elem *b, void *aux);
+static void sema_wait (struct semaphore *sema);
+static void donate_priority (struct lock *lock, int priority);
+
+/* 이름 붙은 잠금의 경합 통계. 통계 슬롯은 잠금과 수명을 같이하지 않으므로
+ * 전역 변수나 정적 변수처럼 해제되지 않는 잠금에만 이름을 붙여야 한다. */
+#define LOCK_STAT_MAX 32
+static struct lock_stat lock_stats[LOCK_STAT_MAX];
+static size_t lock_stat_cnt;
+
+/* If true, record contention statistics for named locks.
+   Controlled by kernel command-line option "-lockstat". */
+bool lock_stat_enabled;
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -49,11 +68,11 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, waiter_less, NULL);
 }
 
 /* sema_down - 세마포어에 대한 Down 또는 P 연산이다.
- * 세마포어를 얻을 수 없다면, 현재 스레드를 세마포어의 waiters 리스트에 priority 내림차순으로 삽입하고, BLOCKED 상태로 전환한다.
+ * 세마포어를 얻을 수 없다면, 현재 스레드를 세마포어의 waiters 힙에 삽입하고, BLOCKED 상태로 전환한다.
  * 그리고 세마포어 값이 양수가 될 때까지 기다렸다가 원자적으로 감소시킨다.
  * 이 함수는 BLOCKED 될 수 있으므로 인터럽트 핸들러 내에서 호출해서는 안된다.
  * 인터럽트가 비활성화된 상태에서 호출될 수 있지만, BLOCKED가 발생하면 다음 스케줄링된 스레드가 인터럽트를 다시 활성화 할 수 있다.
@@ -66,14 +85,39 @@ void sema_down(struct semaphore *sema)
 	ASSERT(!intr_context());
 	old_level = intr_disable();
 	while (sema->value == 0)
-	{
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, (list_less_func *)&higher_priority, NULL);
-		thread_block();
-	}
+		sema_wait(sema);
 	sema->value--;
 	intr_set_level(old_level);
 }
 
+/* sema_wait - 현재 스레드를 sema의 waiters 힙에 넣고 sema_up()이 깨울 때까지 BLOCKED 상태로 전환한다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void sema_wait(struct semaphore *sema)
+{
+	struct thread *t = thread_current();
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	t->wait_on_sema = sema;
+	t->wait_seq = wait_seq++;
+	heap_insert(&sema->waiters, &t->wait_elem);
+	thread_block();
+}
+
+/* waiter_less - 세마포어 waiters 힙의 비교 함수. 우선순위가 높은 스레드가 먼저,
+ * 우선순위가 같다면 먼저 기다리기 시작한 스레드가 먼저 나온다.
+ */
+static bool waiter_less(const struct heap_elem *a_, const struct heap_elem *b_, void *aux UNUSED)
+{
+	const struct thread *a = heap_entry(a_, struct thread, wait_elem);
+	const struct thread *b = heap_entry(b_, struct thread, wait_elem);
+
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->wait_seq < b->wait_seq;
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -100,8 +144,8 @@ sema_try_down (struct semaphore *sema) {
 }
 
 /* sema_up - Up 또는 세마포어에서 V 연산을 수행한다.
- * 세마포어의 값을 증가시키고, 세마포어를 기다리는 스레드가 있다면 하나를 깨운다.
- * 우선순위 기부에 의해 waiters 리스트에서의 우선순위가 내림차순에 어긋날 수 있기에, waiters 리스트를 정렬한다.
+ * 세마포어의 값을 증가시키고, 세마포어를 기다리는 스레드가 있다면 가장 우선순위가 높은 스레드를 깨운다.
+ * 대기 중에 기부로 우선순위가 바뀐 스레드는 thread_update_priority()가 힙에서의 위치를 다시 잡으므로 정렬할 필요가 없다.
  * 현재 실행 중인 스레드가 양보하고, 스케줄링된다. 스케줄러 재량에 따라 다시 같은 스레드가 실행될 수 있다.
  * 이 함수는 인터럽트 핸들러에서 호출될 수 있다.
  */
@@ -112,9 +156,10 @@ void sema_up(struct semaphore *sema)
 	ASSERT(sema != NULL);
 
 	old_level = intr_disable();
-	if (!list_empty(&sema->waiters)) {
-		list_sort(&sema->waiters, (list_less_func *)&higher_priority, NULL);
-		thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
+	if (!heap_empty(&sema->waiters)) {
+		struct thread *t = heap_entry(heap_pop(&sema->waiters), struct thread, wait_elem);
+		t->wait_on_sema = NULL;
+		thread_unblock(t);
 	}
 	sema->value++;
 	intr_set_level(old_level);
@@ -177,46 +222,124 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->max_priority = PRI_MIN;
+	lock->stat = NULL;
 	sema_init (&lock->semaphore, 1);
 }
 
+/* lock_init_named - lock_init()과 같지만 잠금에 name이라는 이름을 붙여 경합 통계를 기록한다.
+ * 통계 슬롯이 모두 찼다면 이름 없는 잠금과 똑같이 동작한다.
+ */
+void lock_init_named(struct lock *lock, const char *name)
+{
+	enum intr_level old_level;
+
+	ASSERT(name != NULL);
+
+	lock_init(lock);
+	old_level = intr_disable();
+	if (lock_stat_cnt < LOCK_STAT_MAX)
+	{
+		lock->stat = &lock_stats[lock_stat_cnt++];
+		lock->stat->name = name;
+	}
+	intr_set_level(old_level);
+}
+
 /* lock_acquire - 잠금을 획득하고 필요한 경우 잠금을 사용할 수 있을 때까지 대기한다.
  * 잠금은 현재 스레드가 이미 보유하고 있지 않아야 한다.
  *
- * 잠금을 획득하지 못할 경우, 해당 잠금을 wait_on_lock에 저장한다.
- * 이후, 현재 스레드의 우선순위가 잠금을 보유하고 있는 스레드의 우선순위보다 높을 경우,
- * 잠금을 보유하고 있는 스레드의 donations 리스트에 현재 스레드를 추가하고 중첩 기부를 수행한다.
- * 
+ * 잠금을 획득하지 못할 경우, 해당 잠금을 wait_on_lock에 저장하고 잠금의 보유자에게 우선순위를 기부한다.
+ * 기부는 잠금의 max_priority를 갱신하고 보유자의 held_locks 힙에서 잠금의 위치를 다시 잡는 것으로 이루어지며,
+ * 보유자가 다른 잠금을 기다리고 있다면 연쇄적으로 전파된다(중첩 기부).
+ * 잠금을 획득하면 남은 대기자들의 우선순위를 잠금의 max_priority로 캐시하고 held_locks 힙에 잠금을 넣는다.
+ *
  * 이 함수는 BLOCKED 될 수 있으므로 인터럽트 핸들러 내에서 호출해서는 안된다.
  * 이 함수는 인터럽트가 비활성화된 상태에서 호출될 수 있지만, Sleep이 필요하면 인터럽트가 다시 활성화된다.
- * 
+ *
  * 고급 스케줄러 사용 시 우선순위 기부를 비활성화한다.
  */
 void lock_acquire (struct lock *lock) {
 	struct thread *t = thread_current();
-	struct thread *holder;
-	
+	struct lock_stat *stat = lock_stat_enabled ? lock->stat : NULL;
+	enum intr_level old_level;
+	int64_t start = 0;
+
 	ASSERT(lock != NULL);
 	ASSERT(!intr_context());
 	ASSERT(!lock_held_by_current_thread(lock));
 
-	if (lock->holder != NULL) {
+	old_level = intr_disable();
+	if (stat != NULL) {
+		start = timer_ns();
+		if (lock->semaphore.value == 0)
+			stat->contended++;
+	}
+	while (lock->semaphore.value == 0) {
 		t->wait_on_lock = lock;
-		if (thread_get_priority() > lock->holder->priority && !thread_mlfqs) {
-			list_insert_ordered(&lock->holder->donations, &t->d_elem, (list_less_func *)&higher_priority, NULL);
-			while (t->wait_on_lock != NULL) {
-				holder = t->wait_on_lock->holder;
-				if (t->priority > holder->priority) {
-					holder->priority = t->priority;
-					t = holder;
-				}
-				else break;
-			}
-		}
+		if (!thread_mlfqs)
+			donate_priority(lock, t->priority);
+		sema_wait(&lock->semaphore);
+	}
+	lock->semaphore.value--;
+	t->wait_on_lock = NULL;
+	lock->holder = t;
+
+	lock->max_priority = PRI_MIN;
+	if (!heap_empty(&lock->semaphore.waiters))
+		lock->max_priority = heap_entry(heap_top(&lock->semaphore.waiters), struct thread, wait_elem)->priority;
+	heap_insert(&t->held_locks, &lock->elem);
+	if (!thread_mlfqs && lock->max_priority > t->priority)
+		thread_update_priority(t, lock->max_priority);
+
+	if (stat != NULL) {
+		int64_t now = timer_ns();
+		stat->acquired++;
+		stat->wait_total += now - start;
+		stat->wait_max = MAX(stat->wait_max, now - start);
+		stat->acquired_at = now;
+	}
+	intr_set_level(old_level);
+}
+
+/* donate_priority - lock을 기다리는 스레드의 우선순위 priority를 lock의 보유자에게 기부한다.
+ * 보유자의 유효 우선순위가 올라가고, 보유자가 다른 잠금을 기다리고 있다면 그 잠금의 보유자에게 다시 기부한다.
+ * 각 단계는 힙 연산이므로 O(log n)이다. 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void donate_priority(struct lock *lock, int priority)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (lock != NULL && lock->holder != NULL && priority > lock->max_priority) {
+		struct thread *holder = lock->holder;
+
+		heap_remove(&holder->held_locks, &lock->elem);
+		lock->max_priority = priority;
+		heap_insert(&holder->held_locks, &lock->elem);
+
+		if (priority <= holder->priority)
+			break;
+		thread_update_priority(holder, priority);
+		sched_trace(SCHED_DONATE, holder, thread_current()->tid);
+		lock = holder->wait_on_lock;
 	}
-	sema_down(&lock->semaphore);
-	thread_current()->wait_on_lock = NULL;
-	lock->holder = thread_current();
+}
+
+/* lock_priority_less - held_locks 힙의 비교 함수. 기다리는 스레드의 우선순위가 높은 잠금이 먼저 나온다.
+ */
+bool lock_priority_less(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+	return heap_entry(a, struct lock, elem)->max_priority > heap_entry(b, struct lock, elem)->max_priority;
+}
+
+/* lock_donated_priority - 스레드 t가 보유한 잠금들의 대기자에게서 기부받은 가장 높은 우선순위를 반환한다.
+ * 기부받은 우선순위가 없다면 PRI_MIN을 반환한다. 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+int lock_donated_priority(struct thread *t)
+{
+	if (heap_empty(&t->held_locks))
+		return PRI_MIN;
+	return heap_entry(heap_top(&t->held_locks), struct lock, elem)->max_priority;
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -227,51 +350,88 @@ void lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+	{
+		struct thread *t = thread_current ();
+
+		/* 해제 직후에 잠금을 가로챘다면 깨어난 스레드 외의 대기자가 남아있을 수 있으므로,
+		   lock_acquire()와 마찬가지로 남은 대기자의 우선순위를 캐시하고 기부받는다. */
+		lock->holder = t;
+		lock->max_priority = PRI_MIN;
+		if (!heap_empty (&lock->semaphore.waiters))
+			lock->max_priority = heap_entry (heap_top (&lock->semaphore.waiters), struct thread, wait_elem)->priority;
+		heap_insert (&t->held_locks, &lock->elem);
+		if (!thread_mlfqs && lock->max_priority > t->priority)
+			thread_update_priority (t, lock->max_priority);
+		if (lock_stat_enabled && lock->stat != NULL)
+		{
+			lock->stat->acquired++;
+			lock->stat->acquired_at = timer_ns ();
+		}
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
 /* lock_release - 현재 스레드가 소유하고 있는 잠금을 해제한다.
  *
- * 잠금이 해제되면, 해당 잠금을 가지고 있던 스레드의 donations 리스트에서 해당 잠금을 기다리고 있던 스레드를 삭제한다.
- * 그리고 다중 기부를 수행하기 위해 donations 리스트를 검사하여 현재 스레드의 우선순위를 재설정한다.
- * 만약 donations 리스트가 비어있지 않다면, 현재 스레드의 우선순위를 donations 리스트의 가장 높은 우선순위로 설정하고,
- * donations 리스트가 비어있다면, 현재 스레드의 우선순위를 원래의 우선순위로 설정한다.
- * 
+ * 잠금을 held_locks 힙에서 제거한 뒤, 남은 잠금들 중 가장 높은 max_priority와 원래 우선순위 중
+ * 큰 값으로 현재 스레드의 우선순위를 재설정한다(다중 기부). 대기자를 훑을 필요가 없으므로 O(log n)이다.
+ *
  * 인터럽트 핸들러는 잠금을 획득할 수 없으므로 인터럽트 핸들러 내에서 잠금을 해제하려고 시도하는 것은 의미가 없다.
- * 
+ *
  * 고급 스케줄러 사용 시 우선순위 기부를 비활성화한다.
  */
 void lock_release (struct lock *lock) {
+	struct thread *t = thread_current();
+	enum intr_level old_level;
+
 	ASSERT(lock != NULL);
 	ASSERT(lock_held_by_current_thread(lock));
 
-	struct thread *lock_holder = lock->holder;
-	struct thread *t;
-	struct list_elem *e;
-
-	for (e = list_begin(&lock->holder->donations); e != list_end(&lock->holder->donations); e = list_next(e)) {
-		t = list_entry(e, struct thread, d_elem);
-		if (t->wait_on_lock == lock)
-			list_remove(e);
-	}
-
-	if (!thread_mlfqs) {
-		if (!list_empty(&lock_holder->donations)) {
-			lock_holder->priority = list_entry(list_front(&lock_holder->donations), struct thread, d_elem)->priority;
-		}
-		else
-			lock_holder->priority = lock_holder->original_priority;
+	old_level = intr_disable();
+	if (lock_stat_enabled && lock->stat != NULL && lock->stat->acquired_at != 0) {
+		int64_t held = timer_ns() - lock->stat->acquired_at;
+		lock->stat->hold_total += held;
+		lock->stat->hold_max = MAX(lock->stat->hold_max, held);
 	}
+	heap_remove(&t->held_locks, &lock->elem);
+	if (!thread_mlfqs)
+		thread_update_priority(t, MAX(t->original_priority, lock_donated_priority(t)));
 	lock->holder = NULL;
 	sema_up (&lock->semaphore);
+	intr_set_level(old_level);
+}
+
+/* lock_print_stats - 이름 붙은 잠금들의 경합 통계를 출력한다. -lockstat 옵션이 꺼져 있다면 아무것도 하지 않는다.
+ * 평균과 최대 대기/보유 시간은 마이크로초 단위로 출력한다.
+ */
+void lock_print_stats(void)
+{
+	size_t i;
+
+	if (!lock_stat_enabled)
+		return;
+
+	printf("Locks: %-16s %10s %10s %10s %10s %10s %10s\n", "name", "acquired",
+		   "contended", "wait avg", "wait max", "hold avg", "hold max");
+	for (i = 0; i < lock_stat_cnt; i++) {
+		const struct lock_stat *s = &lock_stats[i];
+		int64_t n = s->acquired > 0 ? (int64_t)s->acquired : 1;
+
+		printf("Locks: %-16s %10llu %10llu %10lld %10lld %10lld %10lld\n", s->name,
+			   (unsigned long long)s->acquired, (unsigned long long)s->contended,
+			   s->wait_total / n / 1000, s->wait_max / 1000,
+			   s->hold_total / n / 1000, s->hold_max / 1000);
+	}
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -284,12 +444,16 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's waiters heap. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct heap_elem elem;              /* Heap element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* 기다리는 스레드. */
+	uint64_t seq;                       /* 대기 순번. */
 };
 
+static bool cond_less (const struct heap_elem *a, const struct heap_elem *b, void *aux);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -297,7 +461,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	heap_init (&cond->waiters, cond_less, NULL);
 }
 
 /* cond_wait - 잠금을 원자적으로 해제하고 다른 코드가 COND 신호를 보낼 때까지 기다린다.
@@ -316,6 +480,7 @@ cond_init (struct condition *cond) {
  */
 void cond_wait (struct condition *cond, struct lock *lock) {
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -323,7 +488,16 @@ void cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	list_insert_ordered(&cond->waiters, &waiter.elem, (list_less_func *)&cond_priority, NULL);
+	waiter.thread = thread_current ();
+
+	/* 기다리는 동안 우선순위가 바뀌면 thread_update_priority()가 인터럽트 핸들러에서도
+	   힙의 위치를 다시 잡으므로, 힙은 인터럽트를 끈 상태에서 다룬다. */
+	old_level = intr_disable ();
+	waiter.seq = wait_seq++;
+	waiter.thread->wait_on_cond = cond;
+	waiter.thread->cond_elem = &waiter.elem;
+	heap_insert (&cond->waiters, &waiter.elem);
+	intr_set_level (old_level);
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
@@ -337,15 +511,22 @@ void cond_wait (struct condition *cond, struct lock *lock) {
  * 인터럽트 핸들러는 잠금을 획득할 수 없으므로 인터럽트 핸들러 내에서 조건 변수를 신호로 보내는 것은 의미가 없다.
  */
 void cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	struct semaphore_elem *waiter = NULL;
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters)) {
-		list_sort(&cond->waiters, (list_less_func *)&cond_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters), struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	if (!heap_empty (&cond->waiters)) {
+		waiter = heap_entry (heap_pop (&cond->waiters), struct semaphore_elem, elem);
+		waiter->thread->wait_on_cond = NULL;
 	}
+	intr_set_level (old_level);
+	if (waiter != NULL)
+		sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -358,16 +539,19 @@ void cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!heap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
 
-/* cond_priority - 조건 변수의 대기자 리스트에서 우선순위가 높은 스레드를 찾는다.
+/* cond_less - 조건 변수 waiters 힙의 비교 함수. 현재 우선순위가 높은 스레드가 먼저,
+ * 같다면 먼저 기다린 스레드가 먼저 나온다.
+ * 대기 중에 우선순위가 바뀐 스레드는 thread_update_priority()가 힙에서의 위치를 다시 잡는다.
  */
-bool cond_priority(const struct list_elem *a, const struct list_elem  *b, void *aux UNUSED) {
-    struct semaphore_elem *sema_a = list_entry(a, struct semaphore_elem, elem);
-    struct semaphore_elem *sema_b = list_entry(b, struct semaphore_elem, elem);
-    struct thread *t_a = list_entry(list_begin(&sema_a->semaphore.waiters), struct thread, elem);
-    struct thread *t_b = list_entry(list_begin(&sema_b->semaphore.waiters), struct thread, elem);
-    return t_a->priority > t_b->priority;
-}
\ No newline at end of file
+static bool cond_less(const struct heap_elem *a_, const struct heap_elem *b_, void *aux UNUSED) {
+	const struct semaphore_elem *a = heap_entry(a_, struct semaphore_elem, elem);
+	const struct semaphore_elem *b = heap_entry(b_, struct semaphore_elem, elem);
+
+	if (a->thread->priority != b->thread->priority)
+		return a->thread->priority > b->thread->priority;
+	return a->seq < b->seq;
+}
@@ -5,5 +5,9 @@ threads_SRC += threads/intr-stubs.S	# Interrupt stubs.
 threads_SRC += threads/synch.c		# Synchronization.
 threads_SRC += threads/palloc.c		# Page allocator.
 threads_SRC += threads/malloc.c		# Subpage allocator.
+threads_SRC += threads/slab.c		# Slab object caches.
+threads_SRC += threads/memstat.c	# Kernel memory accounting.
 threads_SRC += threads/start.S		# Startup code.
 threads_SRC += threads/mmu.c		    # Memory management unit related things.
+threads_SRC += threads/sched-trace.c	# Scheduler event tracing.
+threads_SRC += threads/workqueue.c	# Deferred work thread pool.
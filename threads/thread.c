@@ -11,6 +11,9 @@
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "threads/fixed-point.h"
+#include "threads/sched-trace.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -25,15 +28,15 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* THREAD_READY 상태의 스레드 리스트, 즉 실행할 준비가 되었지만 실제로 실행되지는 않은 스레드의 리스트
- * priority를 기준으로 내림차순 정렬되어 있다.
+/* THREAD_READY 상태의 스레드, 즉 실행할 준비가 되었지만 실제로 실행되지는 않은 스레드의 다단계 run queue.
+ * ready_queues[p]는 우선순위가 p인 스레드들의 FIFO 리스트이고,
+ * ready_mask의 p번째 비트는 ready_queues[p]가 비어있지 않음을 나타낸다.
+ * 가장 높은 우선순위의 스레드는 ready_mask의 최상위 비트로 O(1)에 찾을 수 있다.
+ * ready_cnt는 run queue에 들어있는 스레드의 수이다.
  */
-static struct list ready_list;
-
-/* THREAD_BLOCKED 상태의 스레드 리스트, 즉 실행할 준비가 되지 않은 스레드의 리스트
- * wakeup_tick을 기준으로 오름차순 정렬되어 있다.
- */
-static struct list sleep_list;
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_mask;
+static size_t ready_cnt;
 
 /* RUNNING, READY, BLOCKED 상태의 모든 스레드 리스트
  * IDLE 스레드는 포함하지 않는다.
@@ -55,6 +58,16 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* destruction_req의 스레드를 해제하는 작업. */
+static struct work reap_work;
+
+/* 재사용을 위해 보관 중인 죽은 스레드들. elem으로 연결되며 인터럽트를 끄고 다룬다.
+ * 보관된 스레드의 페이지와 fdt는 그대로 다시 쓸 수 있으므로 thread_create()가 palloc과 0 채우기를 건너뛴다.
+ * fdt는 process_exit()가 모든 파일을 닫은 상태이므로 0, 1번을 제외하면 이미 비어 있다. */
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+
 /* Statistics. */
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
@@ -76,6 +89,14 @@ bool thread_mlfqs;
  */
 int load_avg;
 
+/* decay_epoch - 부팅 이후 recent_cpu 감쇠가 수행된 횟수(초).
+ * decay_history - e번째 감쇠에 사용된 감쇠 계수를 decay_history[e % DECAY_HISTORY]에 기록한다.
+ * 각 스레드는 자신에게 반영된 감쇠 횟수를 기억하고, 필요할 때 밀린 감쇠를 한꺼번에 반영한다.
+ */
+#define DECAY_HISTORY 256
+static int64_t decay_epoch;
+static int decay_history[DECAY_HISTORY];
+
 
 static void kernel_thread(thread_func *, void *aux);
 
@@ -85,13 +106,18 @@ static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
+static void ready_queue_push(struct thread *t);
+static void ready_queue_remove(struct thread *t);
+static struct thread *ready_queue_pop(void);
+static int ready_queue_max_priority(void);
 
-void calculate_load_avg(void);
-void calculate_all_recent_cpu(void);
-int calculate_one_recent_cpu(struct thread *t);
-void recent_cpu_plus(void);
-void calculate_all_priority(void);
 int calculate_one_priority(struct thread *t);
+static int calculate_decay(void);
+static void mlfqs_refresh(struct thread *t);
+static void stats_charge(struct thread *t, int64_t *bucket, int64_t now);
+static void reap_dying_threads(struct work *work);
+static struct thread *thread_cache_get(void);
+static void thread_cache_put(struct thread *t);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -136,11 +162,15 @@ void thread_init(void)
 	lgdt(&gdt_ds);
 
 	/* Init the globla thread context */
-	lock_init(&tid_lock);
-	list_init(&ready_list);
-	list_init(&sleep_list);
+	lock_init_named(&tid_lock, "tid");
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init(&ready_queues[i]);
+	ready_mask = 0;
+	ready_cnt = 0;
 	list_init(&all_list);
 	list_init(&destruction_req);
+	work_init(&reap_work, reap_dying_threads);
+	list_init(&thread_cache);
 	load_avg = 0;
 
 	/* Set up a thread structure for the running thread. */
@@ -182,12 +212,25 @@ void thread_tick(void)
 #endif
 	else
 		kernel_ticks++;
+	stats_charge(t, &t->stats.run_ns, timer_ns());
 
 	/* Enforce preemption. */
 	if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return();
 }
 
+/* thread_get_stats - 현재 스레드의 스케줄링 통계를 지금 시각까지 정산하여 st에 복사한다.
+ */
+void thread_get_stats(struct thread_stats *st)
+{
+	struct thread *t = thread_current();
+	enum intr_level old_level = intr_disable();
+
+	stats_charge(t, &t->stats.run_ns, timer_ns());
+	*st = t->stats;
+	intr_set_level(old_level);
+}
+
 /* Prints thread statistics. */
 void thread_print_stats(void)
 {
@@ -197,7 +240,7 @@ void thread_print_stats(void)
 
 /* 새로운 커널 스레드를 생성한다. NAME은 스레드의 이름이며, PRIORITY는 스레드의 우선순위이다.
  * FUNCTION은 스레드가 실행할 함수이며, AUX는 FUNCTION에 전달할 인자이다.
- * 스레드를 생성하고, ready_list에 스레드를 추가한다.
+ * 스레드를 생성하고, run queue에 스레드를 추가한다.
  * 새 스레드의 tid를 반환하거나 생성에 실패하면 TID_ERROR를 반환한다.
  * FUNCTION이 실행되는 시점은 thread_create()가 반환된 이후이다.
  * 새로 생성된 스레드와 현재 실행 중인 스레드의 우선 순위를 비교하여 현재 스레드의 우선 순위가 더 낮다면 CPU를 양보한다.
@@ -211,14 +254,29 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 {
 	enum intr_level old_level;
 	struct thread *t;
+	struct file **fdt;
 	tid_t tid;
 
 	ASSERT(function != NULL);
 
-	/* Allocate thread. */
-	t = palloc_get_page(PAL_ZERO);
-	if (t == NULL)
-		return TID_ERROR;
+	/* Allocate thread.
+	 * 보관 중인 죽은 스레드가 있다면 그 페이지와 fdt를 재사용한다.
+	 * init_thread()가 struct thread를 초기화하므로 스레드 페이지 전체를 0으로 채울 필요는 없다. */
+	t = thread_cache_get();
+	if (t != NULL)
+		fdt = t->fdt;
+	else
+	{
+		t = palloc_get_page(0);
+		if (t == NULL)
+			return TID_ERROR;
+		fdt = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
+		if (fdt == NULL)
+		{
+			palloc_free_page(t);
+			return TID_ERROR;
+		}
+	}
 
 	/* Initialize thread. */
 	init_thread(t, name, priority);
@@ -236,21 +294,8 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-	//t->fdt = palloc_get_multiple(PAL_ZERO | PAL_ASSERT, FDT_PAGES);
-	t->fdt = (struct file **)palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if (t->fdt == NULL)
-	{
-		palloc_free_page(t);
-		return TID_ERROR;
-	}
-	// fdt 배열을 동적으로 할당
-	//struct file** fdt = (struct file**)malloc(FDT_SIZE * sizeof(struct file*));
-
-	// fdt 배열의 모든 요소를 NULL로 초기화
-	for (int i = 0; i < FDT_SIZE; i++) {
-    	t->fdt[i] = NULL;
-	}
-
+	// fdt는 새로 할당했다면 PAL_ZERO로, 재사용한다면 process_exit()에서 이미 비워져 있다.
+	t->fdt = fdt;
 	t->fdt[0] = 0;
 	t->fdt[1] = 1;
 	// 현재 스레드의 자식으로 추가
@@ -276,11 +321,12 @@ void thread_block(void)
 {
 	ASSERT(!intr_context());
 	ASSERT(intr_get_level() == INTR_OFF);
+	sched_trace(SCHED_BLOCK, thread_current(), 0);
 	thread_current()->status = THREAD_BLOCKED;
 	schedule();
 }
 
-/* thread_unblock - BLOCKED 스레드 t를 READY 상태로 전환하고 ready_list에 우선순위 내림차순으로 삽입한다.
+/* thread_unblock - BLOCKED 스레드 t를 READY 상태로 전환하고 t의 우선순위에 해당하는 run queue의 맨 뒤에 삽입한다.
  * t가 BLOCKED 상태가 아니라면 에러이다. (running thread를 READY 상태로 전환하려면 thread_yield()를 사용하라)
  * 이 함수는 현재 실행중인 스레드를 선점하지 않는다. 이것은 중요할 수 있다.
  * 만약 호출자가 직접 인터럽트를 비활성화했다면, 스레드를 unblock하고 다른 데이터를 업데이트할 수 있다고 기대할 수 있다.
@@ -292,7 +338,9 @@ void thread_unblock(struct thread *t)
 	ASSERT(t->status == THREAD_BLOCKED);
 
 	old_level = intr_disable();
-	list_insert_ordered(&ready_list, &t->elem, (list_less_func *)higher_priority, NULL);
+	sched_trace(SCHED_WAKEUP, t, running_thread()->tid);
+	stats_charge(t, &t->stats.block_ns, timer_ns());
+	ready_queue_push(t);
 	t->status = THREAD_READY;
 	intr_set_level(old_level);
 }
@@ -340,13 +388,14 @@ void thread_exit(void)
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable();
+	sched_trace(SCHED_EXIT, thread_current(), thread_current()->exit_status);
 	do_schedule(THREAD_DYING);
 	NOT_REACHED();
 }
 
-/* thread_yield - 현재 실행 중인 스레드가 CPU를 양보하고, ready_list에 우선순위 내림차순으로 삽입한다.
+/* thread_yield - 현재 실행 중인 스레드가 CPU를 양보하고, 자신의 우선순위에 해당하는 run queue의 맨 뒤에 삽입한다.
  * 현재 스레드는 BLOCKED 상태로 전환되지 않으며 스케줄러의 재량에 따라 즉시 다시 스케줄될 수 있다.
- * 만약 현재 스레드가 Idle 스레드라면 ready_list에 삽입하지 않는다.
+ * 만약 현재 스레드가 Idle 스레드라면 run queue에 삽입하지 않는다.
  */
 void thread_yield(void)
 {
@@ -357,32 +406,78 @@ void thread_yield(void)
 
 	old_level = intr_disable();
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, (list_less_func *)higher_priority, NULL);
+		ready_queue_push(curr);
 	do_schedule(THREAD_READY);
 	intr_set_level(old_level);
 }
 
-void thread_try_yield(void) {
-	if (!list_empty(&ready_list) && thread_current() != idle_thread) {
-		if (list_entry(list_front(&ready_list), struct thread, elem)->priority > thread_current()->priority) {
-			thread_yield();
-		}
+/* thread_try_yield - run queue에 현재 스레드보다 우선순위가 높은 스레드가 있으면 CPU를 양보한다.
+ * 외부 인터럽트 컨텍스트에서 호출되면 인터럽트 핸들러가 반환될 때 양보하도록 예약한다.
+ */
+void thread_try_yield(void)
+{
+	if (thread_current() == idle_thread)
+		return;
+	if (ready_queue_max_priority() <= thread_current()->priority)
+		return;
+
+	if (intr_context())
+		intr_yield_on_return();
+	else
+		thread_yield();
+}
+
+/* thread_update_priority - 스레드 t의 (기부를 포함한) 유효 우선순위를 priority로 변경한다.
+ * t가 run queue에 들어있다면 새로운 우선순위에 해당하는 큐의 맨 뒤로 옮겨서 run queue가 어긋나지 않도록 한다.
+ * t가 세마포어나 조건 변수를 기다리고 있다면 waiters 힙에서의 위치를 다시 잡는다.
+ */
+void thread_update_priority(struct thread *t, int priority)
+{
+	enum intr_level old_level;
+
+	ASSERT(is_thread(t));
+	ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable();
+	if (t->status == THREAD_READY && t != idle_thread && t->priority != priority)
+	{
+		ready_queue_remove(t);
+		t->priority = priority;
+		ready_queue_push(t);
+	}
+	else if (t->priority != priority)
+	{
+		struct semaphore *sema = t->status == THREAD_BLOCKED ? t->wait_on_sema : NULL;
+		struct condition *cond = t->wait_on_cond;
+
+		if (sema != NULL)
+			heap_remove(&sema->waiters, &t->wait_elem);
+		if (cond != NULL)
+			heap_remove(&cond->waiters, t->cond_elem);
+		t->priority = priority;
+		if (sema != NULL)
+			heap_insert(&sema->waiters, &t->wait_elem);
+		if (cond != NULL)
+			heap_insert(&cond->waiters, t->cond_elem);
 	}
+	intr_set_level(old_level);
 }
 
 /* thread_set_priority - 현재 스레드의 우선순위를 새로운 우선순위로 설정하고,
- * 우선순위가 낮아진다면 ready_list에서 자신보다 더 높은 우선순위를 가진 스레드가 있는지 확인하여야 한다.
+ * 우선순위가 낮아진다면 run queue에 자신보다 더 높은 우선순위를 가진 스레드가 있는지 확인하여야 한다.
+ * 보유한 잠금을 통해 기부받은 우선순위가 더 높다면 유효 우선순위는 그대로 유지된다.
  * 고급 스케줄러를 사용하는 경우에는 이 함수를 사용하지 않는다.
  */
 void thread_set_priority(int new_priority)
 {
-	thread_current()->original_priority = new_priority;
-	if (list_empty(&thread_current()->donations))
-	{
-		thread_current()->priority = new_priority;
-	}
-	if (!list_empty(&ready_list) && list_entry(list_front(&ready_list), struct thread, elem)->priority > new_priority)
-		thread_yield();
+	struct thread *curr = thread_current();
+	enum intr_level old_level = intr_disable();
+	int donated = lock_donated_priority(curr);
+
+	curr->original_priority = new_priority;
+	curr->priority = new_priority > donated ? new_priority : donated;
+	intr_set_level(old_level);
+	thread_try_yield();
 }
 
 /* thread_get_priority - 현재 스레드의 우선순위를 반환한다.
@@ -428,40 +523,74 @@ int thread_get_recent_cpu(void)
  */
 void calculate_load_avg(void)
 {
-	int ready_threads = list_size(&ready_list);
+	int ready_threads = ready_cnt;
 	if (thread_current() != idle_thread)
 		ready_threads++;
 	load_avg = multiply_fixed_point((59 * F) / 60, load_avg) + (((1 * F) / 60) * ready_threads);
 }
 
-/* calculate_all_recent_cpu - 모든 스레드의 recent_cpu를 1초마다 계산한다.
+/* calculate_recent_cpu_decay - 1초마다 모든 스레드의 recent_cpu에 적용되는 감쇠를 수행한다.
+ * 감쇠 계수를 decay_history에 기록하고 decay_epoch를 하나 증가시킨 뒤 현재 스레드만 갱신한다.
+ * 다른 스레드는 밀린 감쇠를 mlfqs_refresh()로 나중에 한꺼번에 반영한다.
+ * BLOCKED 스레드는 run queue에 다시 들어갈 때, run queue에 있는 스레드는 ready_queue_pop()에서 꺼낼 때 반영한다.
+ * 따라서 스레드 수와 관계없이 O(1)이다.
  */
-void calculate_all_recent_cpu(void)
+void calculate_recent_cpu_decay(void)
 {
-	if (list_empty(&all_list))
-		return;
+	struct thread *curr = thread_current();
 
-	struct list_elem *e;
-	struct thread *t;
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
-	{
-		t = list_entry(e, struct thread, a_elem);
-		t->recent_cpu = calculate_one_recent_cpu(t);
-		t->priority = calculate_one_priority(t);
-	}
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	decay_history[decay_epoch % DECAY_HISTORY] = calculate_decay();
+	decay_epoch++;
+
+	if (curr != idle_thread)
+		mlfqs_refresh(curr);
 }
 
-/* calculate_one_recent_cpu - 스레드 t의 recent_cpu를 계산한다.
+/* calculate_decay - 현재 load_avg로 recent_cpu의 감쇠 계수를 계산한다.
  * decay = (2 * load_avg) / (2 * load_avg + 1)
+ */
+static int calculate_decay(void)
+{
+	return divide_fixed_point(multiply_fixed_point_integer(load_avg, 2), add_fixed_point_integer(multiply_fixed_point_integer(load_avg, 2), 1));
+}
+
+/* calculate_one_recent_cpu - 감쇠 계수 decay로 스레드 t의 recent_cpu를 계산한다.
  * recent_cpu = decay * recent_cpu + nice
  */
-int calculate_one_recent_cpu(struct thread *t)
+int calculate_one_recent_cpu(struct thread *t, int decay)
 {
-	int decay = divide_fixed_point(multiply_fixed_point_integer(load_avg, 2), add_fixed_point_integer(multiply_fixed_point_integer(load_avg, 2), 1));
 	int _recent_cpu = add_fixed_point_integer(multiply_fixed_point(decay, t->recent_cpu), t->nice);
 	return _recent_cpu;
 }
 
+/* mlfqs_refresh - 스레드 t가 놓친 감쇠를 decay_history에서 순서대로 반영하고 priority를 다시 계산한다.
+ * DECAY_HISTORY초보다 오래 갱신되지 않았다면 기록이 없는 감쇠는 가장 오래된 기록의 계수 d로 반복되었다고 보고,
+ * recent_cpu = d * recent_cpu + nice가 수렴하는 값 nice / (1 - d)에서 시작하여 기록이 남아있는 감쇠를 반영한다.
+ * 그동안 처음 recent_cpu의 영향은 d^DECAY_HISTORY 이하로 줄어든다.
+ * t는 run queue에 들어있지 않아야 한다.
+ */
+static void mlfqs_refresh(struct thread *t)
+{
+	int64_t epoch = t->decay_epoch;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (decay_epoch - epoch > DECAY_HISTORY)
+	{
+		int one_minus_decay;
+
+		epoch = decay_epoch - DECAY_HISTORY;
+		one_minus_decay = F - decay_history[epoch % DECAY_HISTORY];
+		t->recent_cpu = divide_fixed_point(convert_to_fixed_point(t->nice), one_minus_decay);
+	}
+	for (; epoch < decay_epoch; epoch++)
+		t->recent_cpu = calculate_one_recent_cpu(t, decay_history[epoch % DECAY_HISTORY]);
+	t->decay_epoch = decay_epoch;
+	t->priority = calculate_one_priority(t);
+}
+
 /* recent_cpu_plus - 현재 스레드의 recent_cpu를 1초마다 1 증가시킨다.
  */
 void recent_cpu_plus(void)
@@ -474,22 +603,17 @@ void recent_cpu_plus(void)
 	}
 }
 
-/* calculate_all_priority - 모든 스레드의 priority를 4 ticks마다 계산한다.
+/* calculate_current_priority - 현재 스레드의 priority를 4 ticks마다 계산한다.
+ * 감쇠 사이에 recent_cpu가 변하는 스레드는 실행 중인 스레드뿐이므로 다른 스레드는 다시 계산할 필요가 없다.
  */
-void calculate_all_priority(void) 
+void calculate_current_priority(void)
 {
-	if (list_empty(&all_list))
-		return;
-
-	struct list_elem *e;
-	struct thread *t;
+	struct thread *t = thread_current();
 
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
-	{
-		t = list_entry(e, struct thread, a_elem);
+	if (t != idle_thread)
 		t->priority = calculate_one_priority(t);
-	}
 }
+
 /* calculate_one_priority - 스레드 t의 priority를 계산한다.
  */
 int calculate_one_priority(struct thread *t)
@@ -518,10 +642,19 @@ static void idle(void *idle_started_ UNUSED)
 
 	for (;;)
 	{
+		/* 실행할 스레드가 생길 때까지 PAL_ZERO 요청에 쓸 페이지를 미리 0으로 채워 둔다.
+		   페이지 하나마다 run queue를 확인하므로 깨어난 스레드는 길어야 페이지 하나를 채우는 동안만 기다린다. */
+		while (ready_cnt == 0 && palloc_zero_idle())
+			continue;
+
 		/* Let someone else run. */
 		intr_disable();
 		thread_block();
 
+		/* With -o nohz, stop the periodic tick until the next timer
+		   deadline before halting. */
+		timer_idle_enter();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -549,7 +682,7 @@ static void kernel_thread(thread_func *function, void *aux)
 }
 
 /* init_thread - 스레드 t를 name이라는 priority를 가진 BLOCKED 스레드로 초기화한다.
- * donations 리스트를 초기화한다.
+ * 보유 잠금 힙(held_locks)을 초기화한다.
  */
 static void init_thread(struct thread *t, const char *name, int priority)
 {
@@ -565,8 +698,10 @@ static void init_thread(struct thread *t, const char *name, int priority)
 	t->original_priority = priority;
 	t->nice = 0;
 	t->recent_cpu = 0;
+	t->decay_epoch = decay_epoch;
+	t->stats.stamp_ns = timer_ns();
 	t->magic = THREAD_MAGIC;
-	list_init(&t->donations);
+	heap_init(&t->held_locks, lock_priority_less, NULL);
 	/* Project 2: System Call */
 	list_init(&t->child_list);
 	sema_init(&t->load_sema, 0);
@@ -585,10 +720,75 @@ static void init_thread(struct thread *t, const char *name, int priority)
    idle_thread. */
 static struct thread *next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
+	if (ready_mask == 0)
 		return idle_thread;
 	else
-		return list_entry(list_pop_front(&ready_list), struct thread, elem);
+		return ready_queue_pop();
+}
+
+/* ready_queue_push - 스레드 t를 t의 우선순위에 해당하는 run queue의 맨 뒤에 삽입한다.
+ * 같은 우선순위의 스레드끼리는 삽입된 순서대로(FIFO) 실행된다.
+ * 고급 스케줄러를 사용하는 경우, 삽입하기 전에 t의 recent_cpu와 priority를 최신으로 갱신한다.
+ */
+static void ready_queue_push(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (thread_mlfqs)
+		mlfqs_refresh(t);
+	list_push_back(&ready_queues[t->priority], &t->elem);
+	ready_mask |= 1ULL << t->priority;
+	ready_cnt++;
+}
+
+/* ready_queue_remove - run queue에 들어있는 스레드 t를 run queue에서 제거한다.
+ * t는 자신의 현재 우선순위에 해당하는 큐에 들어있어야 한다.
+ */
+static void ready_queue_remove(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	list_remove(&t->elem);
+	if (list_empty(&ready_queues[t->priority]))
+		ready_mask &= ~(1ULL << t->priority);
+	ready_cnt--;
+}
+
+/* ready_queue_pop - 가장 높은 우선순위의 큐에서 맨 앞의 스레드를 꺼내어 반환한다.
+ * 고급 스케줄러를 사용하는 경우, 큐에 들어간 뒤에 지난 감쇠를 꺼낼 때 반영한다.
+ * 반영한 우선순위가 남은 스레드들의 큐보다 낮아졌다면 새 우선순위의 큐 뒤로 옮기고 다시 고른다.
+ * 감쇠는 스레드마다 한 번만 반영되므로, 다시 고르는 횟수는 감쇠 이후 처음 꺼내지는 스레드 수를 넘지 않는다.
+ * run queue가 비어있지 않아야 한다.
+ */
+static struct thread *ready_queue_pop(void)
+{
+	struct thread *t;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (;;)
+	{
+		int priority = ready_queue_max_priority();
+
+		ASSERT(priority >= PRI_MIN);
+		t = list_entry(list_front(&ready_queues[priority]), struct thread, elem);
+		ready_queue_remove(t);
+		if (!thread_mlfqs || t->decay_epoch == decay_epoch)
+			return t;
+
+		mlfqs_refresh(t);
+		if (t->priority >= ready_queue_max_priority())
+			return t;
+		ready_queue_push(t);
+	}
+}
+
+/* ready_queue_max_priority - run queue에 있는 스레드 중 가장 높은 우선순위를 반환한다.
+ * run queue가 비어있다면 PRI_MIN - 1을 반환한다.
+ */
+static int ready_queue_max_priority(void)
+{
+	if (ready_mask == 0)
+		return PRI_MIN - 1;
+	return 63 - __builtin_clzll(ready_mask);
 }
 
 /* Use iretq to launch the thread */
@@ -690,22 +890,83 @@ static void thread_launch(struct thread *th)
 /* do_schedule - 새 스레드를 스케줄합니다. 진입시 인터럽트가 꺼져 있어야 한다.
  * 이 함수는 현재 스레드의 상태를 status로 변경한 다음 다른 스레드를 찾아 실행한다.
  * schedule()에서 printf()를 호출하는 것은 안전하지 않다.
- * 매 스케줄 실행 시마다 destruction_req 리스트에 있는 스레드를 해제한다.
+ * destruction_req 리스트에 해제할 스레드가 있다면 system_wq의 워커에게 해제를 맡긴다.
+ * 워크큐가 아직 만들어지지 않은 부팅 초기에는 여기서 직접 해제한다.
  */
 static void do_schedule(int status)
 {
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(thread_current()->status == THREAD_RUNNING);
-	while (!list_empty(&destruction_req))
+	if (!list_empty(&destruction_req))
 	{
-		struct thread *victim =
-			list_entry(list_pop_front(&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		if (workqueue_started(&system_wq))
+			schedule_work(&reap_work);
+		else
+			reap_dying_threads(&reap_work);
 	}
 	thread_current()->status = status;
 	schedule();
 }
 
+/* reap_dying_threads - destruction_req 리스트에 있는 죽은 스레드들을 재사용 캐시에 넣거나 해제한다.
+ * 스레드는 schedule()에서 CPU를 내려놓은 뒤에야 리스트에 들어가므로 해제해도 안전하다.
+ */
+static void reap_dying_threads(struct work *work UNUSED)
+{
+	for (;;)
+	{
+		enum intr_level old_level = intr_disable();
+		struct thread *victim = NULL;
+
+		if (!list_empty(&destruction_req))
+			victim = list_entry(list_pop_front(&destruction_req), struct thread, elem);
+		intr_set_level(old_level);
+
+		if (victim == NULL)
+			break;
+		thread_cache_put(victim);
+	}
+}
+
+/* thread_cache_get - 재사용 캐시에서 죽은 스레드 하나를 꺼내 반환한다. 비어 있다면 NULL을 반환한다.
+ * 반환된 스레드의 fdt는 유효하다.
+ */
+static struct thread *thread_cache_get(void)
+{
+	enum intr_level old_level = intr_disable();
+	struct thread *t = NULL;
+
+	if (!list_empty(&thread_cache))
+	{
+		t = list_entry(list_pop_front(&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+	}
+	intr_set_level(old_level);
+	return t;
+}
+
+/* thread_cache_put - 죽은 스레드 t를 재사용 캐시에 넣는다. 캐시가 가득 찼다면 페이지와 fdt를 해제한다.
+ */
+static void thread_cache_put(struct thread *t)
+{
+	enum intr_level old_level = intr_disable();
+	bool cached = false;
+
+	if (thread_cache_cnt < THREAD_CACHE_MAX && t->fdt != NULL)
+	{
+		list_push_front(&thread_cache, &t->elem);
+		thread_cache_cnt++;
+		cached = true;
+	}
+	intr_set_level(old_level);
+
+	if (!cached)
+	{
+		palloc_free_multiple(t->fdt, FDT_PAGES);
+		palloc_free_page(t);
+	}
+}
+
 /*
  * schedule() - 실행할 다음 스레드를 선택하고 현재 실행 중인 스레드를 다음 스레드로 교체한다.
  */
@@ -730,6 +991,19 @@ static void schedule(void)
 
 	if (curr != next)
 	{
+		sched_trace(SCHED_SWITCH_OUT, curr, curr->status);
+		sched_trace(SCHED_SWITCH_IN, next, curr->tid);
+
+		/* 나가는 스레드의 실행 시간과 들어오는 스레드의 대기 시간을 정산한다.
+		   BLOCKED로 나가면 자발적, READY로 나가면 선점이나 양보에 의한 비자발적 전환이다. */
+		int64_t now = timer_ns();
+		stats_charge(curr, &curr->stats.run_ns, now);
+		if (curr->status == THREAD_BLOCKED)
+			curr->stats.nvcsw++;
+		else if (curr->status == THREAD_READY)
+			curr->stats.nivcsw++;
+		stats_charge(next, &next->stats.wait_ns, now);
+
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
 		   pull out the rug under itself.
@@ -749,6 +1023,16 @@ static void schedule(void)
 	}
 }
 
+/* stats_charge - t의 마지막 정산 이후 지난 시간을 *bucket에 더하고 정산 시각을 now로 옮긴다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void stats_charge(struct thread *t, int64_t *bucket, int64_t now)
+{
+	if (now > t->stats.stamp_ns)
+		*bucket += now - t->stats.stamp_ns;
+	t->stats.stamp_ns = now;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void)
 {
@@ -762,67 +1046,34 @@ static tid_t allocate_tid(void)
 	return tid;
 }
 
-/* higher_priority - ready_list와 waiter를 우선순위 내림차순으로 정렬하기 위한 비교 함수.
- */
-bool higher_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-	struct thread *ta = list_entry(a, struct thread, elem);
-	struct thread *tb = list_entry(b, struct thread, elem);
-	return ta->priority > tb->priority;
-}
-
-/* less_wakeup_ticks - sleep_list를 정렬하기 위한 비교 함수. list_less_func typedef로 선언되어 있다.
- */
-bool less_wakeup_ticks(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-	struct thread *ta = list_entry(a, struct thread, elem);
-	struct thread *tb = list_entry(b, struct thread, elem);
-	return ta->wakeup_ticks < tb->wakeup_ticks;
-}
-
-/* thread_sleep - 현재 실행 중인 스레드들 재운다.
- * sleep_list에 wakeup_ticks 기준으로 오름차순 삽입하고 스레드의 상태를 BLOCKED 상태로 전환한다.
- * thread_block() 내부적으로 schedule()을 호출하여 스케줄링을 수행한다.
- * 
+/* thread_sleep - 현재 실행 중인 스레드를 os_ticks가 ticks에 도달할 때까지 재운다.
+ * 스택에 둔 타이머를 타이머 휠에 등록하고 스레드의 상태를 BLOCKED 상태로 전환한다.
+ * 타이머가 만료되면 타이머 인터럽트에서 thread_wakeup()이 호출되어 스레드가 READY 상태로 전환된다.
+ * 스레드가 깨어나기 전까지 스택은 유지되므로 타이머를 스택에 두어도 안전하다.
+ *
  * Idle 스레드는 thread_sleep()을 호출할 수 없다.
- * 스레드 리스트를 조작할때, 인터럽트를 비활성화하고 조작이 끝나면 다시 활성화해야 한다.
  */
 void thread_sleep(int64_t ticks)
 {
-	enum intr_level old_level = intr_disable();
 	struct thread *t = thread_current();
+	struct timer timer;
+	enum intr_level old_level;
 
 	ASSERT(t != idle_thread);
 
-	t->wakeup_ticks = ticks;
-	list_insert_ordered(&sleep_list, &t->elem, (list_less_func *)less_wakeup_ticks, NULL);
+	old_level = intr_disable();
+	timer_setup(&timer, thread_wakeup, t);
+	timer_add(&timer, ticks);
 	thread_block();
 	intr_set_level(old_level);
 }
 
-/* thread_wakeup - 잠들어 있는 스레드를 깨운다.
- * sleep_list를 순회하면서 wakeup_ticks이 현재 os_ticks보다 작아진 스레드를 깨운다.
- * sleep_list는 wakeup_ticks 기준으로 오름차순으로 정렬되어 있다.
- * 깨어난 스레드는 READY 상태로 전환되고 ready_list에 priority 기준으로 내림차순 삽입된다.
- * 
- * 이 함수는 타이머 인터럽트 핸들러에서 호출된다. 따라서 이 함수는 외부 인터럽트 컨텍스트에서 실행된다.
- * 스레드 리스트를 조작할때, 인터럽트를 비활성화하고 조작이 끝나면 다시 활성화해야 한다.
+/* thread_wakeup - thread_sleep()으로 잠든 스레드 t를 깨운다.
+ * 깨어난 스레드는 READY 상태로 전환되고 자신의 우선순위에 해당하는 run queue의 맨 뒤에 삽입된다.
+ *
+ * 이 함수는 타이머 인터럽트 핸들러에서 타이머 콜백으로 호출된다. 따라서 이 함수는 외부 인터럽트 컨텍스트에서 실행된다.
  */
-void thread_wakeup(int64_t os_ticks)
+void thread_wakeup(void *t)
 {
-	if (list_empty(&sleep_list))
-		return;
-	enum intr_level old_level = intr_disable();
-	struct thread *t;
-
-	while (!list_empty(&sleep_list))
-	{
-		t = list_entry(list_front(&sleep_list), struct thread, elem);
-		if (t->wakeup_ticks > os_ticks)
-			break;
-		list_pop_front(&sleep_list);
-		list_insert_ordered(&ready_list, &t->elem, (list_less_func *)higher_priority, NULL);
-		t->status = THREAD_READY;
-	}
-	intr_set_level(old_level);
-}
\ No newline at end of file
+	thread_unblock(t);
+}
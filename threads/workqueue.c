@@ -0,0 +1,251 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* 워크큐.
+ * 호출한 스레드의 문맥 밖에서 실행해도 되는 작업(쓰기 지연, 스왑 아웃, 죽은 스레드 해제 등)을
+ * 워커 스레드 풀에 넘겨 지연 시간에 민감한 경로에서 느린 작업을 덜어낸다.
+ *
+ * pending 리스트와 워커의 상태는 인터럽트를 끄고 다룬다.
+ * queue_work()는 세마포어 대신 thread_unblock()으로 워커를 깨우므로 CPU를 양보하지 않는다.
+ * 따라서 인터럽트 핸들러(지연 작업의 타이머 포함)나 do_schedule()처럼
+ * 양보할 수 없는 문맥에서도 호출할 수 있다. */
+
+/* 범용 워크큐. */
+struct workqueue system_wq;
+
+/* system_wq의 워커 수와 우선순위. */
+#define SYSTEM_WQ_WORKERS 2
+#define SYSTEM_WQ_PRIORITY PRI_DEFAULT
+
+static void worker_main (void *worker_);
+static void delayed_work_timer (void *dw_);
+static bool work_running (const struct workqueue *, const struct work *);
+
+/* workqueue_init - 범용 워크큐 system_wq를 만든다. thread_start() 이후에 호출되어야 한다.
+ */
+void workqueue_init(void)
+{
+	workqueue_create(&system_wq, "kworker", SYSTEM_WQ_WORKERS, SYSTEM_WQ_PRIORITY);
+}
+
+/* workqueue_create - wq를 workers개의 워커 스레드를 가진 워크큐로 초기화한다.
+ * 워커 스레드는 "name/번호"라는 이름과 priority 우선순위로 생성된다.
+ * 워커 스레드를 만들 수 없다면 커널 패닉이다.
+ */
+void workqueue_create(struct workqueue *wq, const char *name, int workers, int priority)
+{
+	char thread_name[16];
+
+	ASSERT(wq != NULL);
+	ASSERT(0 < workers && workers <= WQ_MAX_WORKERS);
+
+	wq->name = name;
+	list_init(&wq->pending);
+	list_init(&wq->idle_workers);
+	list_init(&wq->flushers);
+	wq->worker_cnt = workers;
+
+	for (int i = 0; i < workers; i++)
+	{
+		wq->workers[i].wq = wq;
+		wq->workers[i].thread = NULL;
+		wq->workers[i].current = NULL;
+		snprintf(thread_name, sizeof thread_name, "%s/%d", name, i);
+		if (thread_create(thread_name, priority, worker_main, &wq->workers[i]) == TID_ERROR)
+			PANIC("%s: cannot create worker thread", name);
+	}
+}
+
+/* workqueue_started - wq가 workqueue_create()로 만들어졌다면 true를 반환한다.
+ * 부팅 초기처럼 워크큐가 아직 없을 때 동기적으로 처리하는 경로를 고르는 데 쓴다.
+ */
+bool workqueue_started(const struct workqueue *wq)
+{
+	return wq->worker_cnt > 0;
+}
+
+/* work_init - work를 func를 실행하는, 어떤 워크큐에도 들어있지 않은 작업으로 초기화한다.
+ */
+void work_init(struct work *work, work_func *func)
+{
+	ASSERT(work != NULL);
+	ASSERT(func != NULL);
+
+	work->func = func;
+	work->wq = NULL;
+	work->pending = false;
+}
+
+/* queue_work - work를 wq의 pending 리스트 끝에 넣고 쉬고 있는 워커가 있다면 하나를 깨운다.
+ * work가 이미 pending 상태라면 아무것도 하지 않고 false를 반환한다.
+ * 실행 중인 작업을 다시 넣는 것은 허용되며, 이 경우 현재 실행이 끝난 뒤 한 번 더 실행된다.
+ * CPU를 양보하지 않으므로 인터럽트 핸들러에서도 호출할 수 있다.
+ */
+bool queue_work(struct workqueue *wq, struct work *work)
+{
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT(wq != NULL);
+	ASSERT(work != NULL);
+
+	old_level = intr_disable();
+	if (!work->pending)
+	{
+		work->pending = true;
+		work->wq = wq;
+		list_push_back(&wq->pending, &work->elem);
+		if (!list_empty(&wq->idle_workers))
+			thread_unblock(list_entry(list_pop_front(&wq->idle_workers), struct thread, elem));
+		queued = true;
+	}
+	intr_set_level(old_level);
+	return queued;
+}
+
+/* schedule_work - work를 범용 워크큐 system_wq에 넣는다.
+ */
+bool schedule_work(struct work *work)
+{
+	return queue_work(&system_wq, work);
+}
+
+/* flush_work - work가 pending 상태도 아니고 실행 중도 아니게 될 때까지 기다린다.
+ * 반환 시점에는 flush_work() 호출 전에 넣은 work의 실행이 모두 끝나 있다.
+ * work는 호출하는 동안 해제되지 않아야 하며, 워커 스레드 자신이 자기 작업을 flush해서는 안된다.
+ */
+void flush_work(struct work *work)
+{
+	struct workqueue *wq;
+	enum intr_level old_level;
+
+	ASSERT(work != NULL);
+	ASSERT(!intr_context());
+
+	old_level = intr_disable();
+	wq = work->wq;
+	while (wq != NULL && (work->pending || work_running(wq, work)))
+	{
+		list_push_back(&wq->flushers, &thread_current()->elem);
+		thread_block();
+	}
+	intr_set_level(old_level);
+}
+
+/* delayed_work_init - dw를 func를 실행하는 지연 작업으로 초기화한다.
+ */
+void delayed_work_init(struct delayed_work *dw, work_func *func)
+{
+	ASSERT(dw != NULL);
+
+	work_init(&dw->work, func);
+	timer_setup(&dw->timer, delayed_work_timer, dw);
+}
+
+/* queue_delayed_work - ticks 틱 뒤에 dw를 wq에 넣는다. ticks가 0 이하라면 바로 넣는다.
+ * dw가 이미 pending 상태이거나 타이머가 걸려 있다면 false를 반환한다.
+ */
+bool queue_delayed_work(struct workqueue *wq, struct delayed_work *dw, int64_t ticks)
+{
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT(wq != NULL);
+	ASSERT(dw != NULL);
+
+	if (ticks <= 0)
+		return queue_work(wq, &dw->work);
+
+	old_level = intr_disable();
+	if (!dw->work.pending && !timer_pending(&dw->timer))
+	{
+		dw->work.wq = wq;
+		timer_add(&dw->timer, timer_ticks() + ticks);
+		queued = true;
+	}
+	intr_set_level(old_level);
+	return queued;
+}
+
+/* cancel_delayed_work - dw의 타이머가 아직 만료되지 않았거나 dw가 실행을 기다리고 있다면 취소하고 true를 반환한다.
+ * 이미 실행 중인 작업은 멈추지 않는다. 실행이 끝나기를 기다리려면 flush_work()를 사용하라.
+ */
+bool cancel_delayed_work(struct delayed_work *dw)
+{
+	enum intr_level old_level;
+	bool canceled;
+
+	ASSERT(dw != NULL);
+
+	old_level = intr_disable();
+	canceled = timer_cancel(&dw->timer);
+	if (dw->work.pending)
+	{
+		list_remove(&dw->work.elem);
+		dw->work.pending = false;
+		canceled = true;
+	}
+	intr_set_level(old_level);
+	return canceled;
+}
+
+/* delayed_work_timer - 지연 작업의 타이머가 만료되면 타이머 인터럽트에서 호출되어 작업을 워크큐에 넣는다.
+ */
+static void delayed_work_timer(void *dw_)
+{
+	struct delayed_work *dw = dw_;
+
+	queue_work(dw->work.wq, &dw->work);
+}
+
+/* work_running - wq의 워커 중 하나가 work를 실행 중이라면 true를 반환한다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static bool work_running(const struct workqueue *wq, const struct work *work)
+{
+	for (int i = 0; i < wq->worker_cnt; i++)
+		if (wq->workers[i].current == work)
+			return true;
+	return false;
+}
+
+/* worker_main - 워커 스레드의 본체. pending 리스트에서 작업을 하나씩 꺼내 실행하고,
+ * 리스트가 비어 있으면 idle_workers에 자신을 넣고 BLOCKED 상태가 된다.
+ *
+ * 작업 함수는 자신의 struct work를 해제할 수 있으므로 실행이 끝난 뒤에는 work를 건드리지 않는다.
+ * 대신 워커의 current를 비우고 flush_work()에서 기다리는 스레드들을 모두 깨워 다시 확인하게 한다.
+ */
+static void worker_main(void *worker_)
+{
+	struct worker *worker = worker_;
+	struct workqueue *wq = worker->wq;
+	enum intr_level old_level;
+
+	worker->thread = thread_current();
+	for (;;)
+	{
+		struct work *work;
+
+		old_level = intr_disable();
+		while (list_empty(&wq->pending))
+		{
+			list_push_back(&wq->idle_workers, &thread_current()->elem);
+			thread_block();
+		}
+		work = list_entry(list_pop_front(&wq->pending), struct work, elem);
+		work->pending = false;
+		worker->current = work;
+		intr_set_level(old_level);
+
+		work->func(work);
+
+		old_level = intr_disable();
+		worker->current = NULL;
+		while (!list_empty(&wq->flushers))
+			thread_unblock(list_entry(list_pop_front(&wq->flushers), struct thread, elem));
+		intr_set_level(old_level);
+	}
+}
@@ -139,6 +139,7 @@ page_fault (struct intr_frame *f) {
 	not_present = (f->error_code & PF_P) == 0;
 	write = (f->error_code & PF_W) != 0;
 	user = (f->error_code & PF_U) != 0;
+	thread_current ()->stats.page_faults++;
 	// 페이지 폴트시 -1 종료 처리
 #ifdef VM
 	/* For project 3 and later. */
@@ -137,7 +137,7 @@ static bool duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	 *    TODO: check whether parent's page is writable or not (set WRITABLE
 	 *    TODO: according to the result). */
 	/* 해석: 부모의 페이지를 새 페이지로 복제하고 부모의 페이지가 쓰기 가능한지 여부를 확인하십시오 (결과에 따라 WRITABLE을 설정하십시오). */
-	memcpy (newpage, parent_page, PGSIZE);
+	copy_page (newpage, parent_page);
 	writable = is_writable (pte);
 
 	/* 5. Add new page to child's page table at address VA with WRITABLE permission. */
@@ -295,7 +295,7 @@ void process_exit (void) {
 		}
 	}
 	file_close(t->self_file);
-	palloc_free_multiple(t->fdt, FDT_PAGES);
+	/* fdt는 스레드 페이지와 함께 재사용되거나 해제된다. (thread.c의 thread_cache_put() 참고) */
 	process_cleanup ();
 	hash_destroy(&t->spt.hash_table , NULL);	//NULL-> h->buckest만 해제, hash_clear로 인해 해시는 이미 해제되어있음.
 	sema_up(&t->wait_sema);
@@ -719,37 +719,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		/* 이 페이지를 채우는 방법을 계산하세요.
-		   FILE에서 PAGE_READ_BYTES 바이트를 읽고
-		   최종 PAGE_ZERO_BYTES 바이트를 0으로 합니다. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		/* lazy_load_segment에 정보를 전달하도록 aux를 설정합니다.*/
-		//void **aux = (file, &page_read_bytes, &page_zero_bytes, &ofs);
-		
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
-		lazy_load_arg->file = file;
-		lazy_load_arg->ofs = ofs;
-		lazy_load_arg->read_bytes = page_read_bytes;
-		lazy_load_arg->zero_bytes = page_zero_bytes;
-
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, lazy_load_arg))
-			return false;
-
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-		ofs += page_read_bytes;
-	}
-	return true;
+	/* 세그먼트 전체를 영역 하나로 등록한다. 페이지는 처음 접근할 때 만들어진다. */
+	return vma_create (&thread_current ()->spt.vmas, upage, upage + read_bytes + zero_bytes,
+			VM_ANON, writable, lazy_load_segment, file, ofs, read_bytes) != NULL;
 }
 
 /* setup_stack - USER_STACK에 스택의 PAGE를 생성한다. 성공하면 true를 반환한다.
@@ -763,10 +735,12 @@ setup_stack (struct intr_frame *if_) {
 
 	/* 스택을 stack_bottom에 매핑하고 즉시 페이지를 요구한다.
 	 * 성공하면 그에 따라 rsp를 설정한다.
+	 * 스택은 아래로 자라는 영역으로 등록하여 mmap이 스택과 겹치지 않게 한다.
 	 * 페이지가 스택임을 표시해야 한다.
 	 */
 
-	if(vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, true)){
+	if(vma_create(&thread_current()->spt.vmas, stack_bottom, (void *) USER_STACK,
+			VM_ANON | VM_MARKER_0, true, NULL, NULL, 0, 0) != NULL){
 		success = vm_claim_page(stack_bottom);
 		if(success){
 			if_->rsp = USER_STACK;
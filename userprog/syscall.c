@@ -36,8 +36,10 @@ void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
 void check_address(uintptr_t addr);
+static void check_writable(void *addr);
 int add_file_to_fdt(struct file *file);
 struct file *get_file_from_fd(int fd);
+int getrusage(struct rusage *usage);
 
 /* Project 3 */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
@@ -59,7 +61,7 @@ static struct intr_frame *frame;
 
 void
 syscall_init (void) {
-	lock_init(&filesys_lock);
+	lock_init_named(&filesys_lock, "filesys");
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -136,6 +138,9 @@ void syscall_handler (struct intr_frame *f) {
 	case SYS_MUNMAP:
 		munmap(f->R.rdi);
 		break;
+	case SYS_GETRUSAGE:
+		f->R.rax = getrusage((struct rusage *)f->R.rdi);
+		break;
 	default:
 		thread_exit();
 		break;
@@ -317,7 +322,8 @@ int read(int fd, void *buffer, unsigned size) {
 			return -1;
 		}
 		struct page * _page = spt_find_page(&thread_current()->spt, buffer);
-		if(_page && !_page->writable){
+		struct vm_area *vma = vma_find(&thread_current()->spt.vmas, buffer);
+		if((_page && !_page->writable) || (!_page && vma && !vma->writable)){
 			exit(-1);
 		}
 		lock_acquire(&filesys_lock);
@@ -391,6 +397,40 @@ void close(int fd) {
 	}
 }
 
+/* getrusage - 현재 프로세스의 CPU 사용 시간과 스케줄링 통계를 usage에 채운다.
+ * 성공하면 0을 반환한다. usage가 유효하지 않거나 쓰기 불가능한 주소라면 프로세스를 종료한다.
+ * usage는 페이지 경계에 걸칠 수 있으므로 처음과 마지막 바이트를 모두 검사한다.
+ */
+int getrusage(struct rusage *usage) {
+	struct thread_stats st;
+
+	check_address((uintptr_t)usage);
+	check_address((uintptr_t)usage + sizeof *usage - 1);
+	check_writable(usage);
+	check_writable((char *)usage + sizeof *usage - 1);
+
+	thread_get_stats(&st);
+	usage->ru_runtime = st.run_ns;
+	usage->ru_waittime = st.wait_ns;
+	usage->ru_blocktime = st.block_ns;
+	usage->ru_nvcsw = st.nvcsw;
+	usage->ru_nivcsw = st.nivcsw;
+	usage->ru_pagefaults = st.page_faults;
+	return 0;
+}
+
+/* check_writable - 커널이 addr에 쓰기 전에, addr을 담은 페이지나 아직 올라오지 않은 영역이
+ * 쓰기 불가능하다면 프로세스를 종료한다. read()와 같은 SPT/VMA 검사이다.
+ */
+static void check_writable(void *addr) {
+	struct page *page = spt_find_page(&thread_current()->spt, addr);
+	struct vm_area *vma = vma_find(&thread_current()->spt.vmas, addr);
+
+	if ((page && !page->writable) || (!page && vma && !vma->writable)) {
+		exit(-1);
+	}
+}
+
 /* check_address - 주소가 유효한지 확인한다.
  */
 void check_address(uintptr_t addr) {
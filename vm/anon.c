@@ -2,9 +2,11 @@
 /*anon.c : file과 mapping이 되지 않은 익명 페이지 구현*/
 
 #include "vm/vm.h"
+#include <stdio.h>
 #include "devices/disk.h"
 #include "threads/vaddr.h"
-#include "threads/mmu.h"	
+#include "threads/mmu.h"
+#include "threads/malloc.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -23,6 +25,66 @@ static const struct page_operations anon_ops = {
 //8개의 disk sector가 page마다 있는 것이다.
 const size_t SECTORS_PER_PAGE = PGSIZE / DISK_SECTOR_SIZE;	// 8 = 4096 / 512
 
+/* 스왑 I/O는 페이지 하나를 섹터 8개짜리 명령 하나로 옮기며, 여러 페이지를 묶어서도 옮긴다.
+ * - 묶어 쓰기: kswapd는 anon_swap_plug()와 anon_swap_unplug() 사이에서 내보내는 페이지들을
+ *   연속된 슬롯에 배정하고 plug_buf에 모았다가 명령 하나로 쓴다.
+ * - 미리 읽기: 스왑 인할 때 같은 프로세스, 같은 VMA의 페이지가 든 이웃 슬롯들을 명령 하나로 함께 읽어
+ *   스왑 캐시에 넣어 두고, 그 페이지들의 폴트는 디스크 대신 캐시에서 복사한다.
+ * 슬롯의 내용은 배정될 때 한 번 쓰이고 비워질 때까지 바뀌지 않으므로, 캐시 항목은 슬롯이 비워질 때만 버린다. */
+
+// 한 번에 묶어 쓰거나 미리 읽는 최대 페이지 수
+#define SWAP_CLUSTER 8
+
+// 스왑 캐시에 둘 수 있는 페이지 수
+#define SWAP_CACHE_PAGES 32
+
+// 슬롯 하나의 상태
+struct swap_slot {
+	uint16_t refs;		// 이 슬롯을 가리키는 페이지 수. copy-on-write로 공유하던 프레임을 내보내면 여러 페이지가 한 슬롯을 쓴다.
+	bool ready;			// 내용이 디스크에 다 쓰였는가? 미리 읽기는 다 쓰인 슬롯만 읽는다.
+	uint64_t *pml4;		// 내보낸 페이지의 주인과
+	void *va;			// 주소. 미리 읽을 이웃을 고를 때 쓴다.
+};
+
+// 스왑 캐시 항목
+struct swap_cache_entry {
+	int slot;			// 담고 있는 슬롯, 비어 있다면 -1
+	void *kva;			// 슬롯 내용의 복사본
+};
+
+// swap_table, swap_slots와 swap_hint를 보호한다. kswapd와 폴트를 처리하는 스레드가 함께 쓴다.
+static struct lock swap_lock;
+
+// 스왑 디스크 I/O와 아래의 묶어 쓰기, 미리 읽기, 스왑 캐시 상태를 보호한다. swap_lock보다 먼저 얻는다.
+static struct lock swap_io_lock;
+
+static struct swap_slot *swap_slots;
+static size_t swap_slot_cnt;
+
+// 다음 스왑 슬롯 탐색을 시작할 위치. 거의 가득 찬 스왑 테이블에서 매번 앞부분부터 다시 훑지 않도록 next-fit으로 찾는다.
+static size_t swap_hint;
+
+// 묶어 쓰기. plug_owner가 내보내는 페이지들은 plug_start부터 연속된 plug_cnt개 슬롯에 배정되어 plug_buf에 모인다.
+static struct thread *plug_owner;
+static uint8_t *plug_buf;
+static int plug_start;
+static size_t plug_cnt;
+
+// 미리 읽기 버퍼와 스왑 캐시
+static uint8_t *ra_buf;
+static struct swap_cache_entry swap_cache[SWAP_CACHE_PAGES];
+static size_t swap_cache_hand;
+
+// 스왑 통계
+static uint64_t swap_out_cnt;		// 내보낸 페이지 수
+static uint64_t swap_write_cnt;		// 쓰기 명령 수
+static uint64_t swap_in_cnt;		// 스왑 인한 페이지 수
+static uint64_t swap_read_cnt;		// 읽기 명령 수
+static uint64_t readahead_cnt;		// 미리 읽어 캐시에 넣은 페이지 수
+static uint64_t swap_cache_hit_cnt;	// 캐시나 묶어 쓰기 버퍼에서 바로 복사한 스왑 인 수
+
+static void swap_flush (void);
+
 /* Initialize the data for anonymous pages */
 /*익명 페이지 초기화*/
 void
@@ -30,10 +92,208 @@ vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
 	/*swap_disk 설정*/
 	swap_disk = disk_get(1,1);
-	size_t swap_size = disk_size(swap_disk) / SECTORS_PER_PAGE;
+	swap_slot_cnt = disk_size(swap_disk) / SECTORS_PER_PAGE;
 	
 	//모든 bit들을 false로 초기화, 사용되면 bit를 true로 바꾼다.
-	swap_table = bitmap_create(swap_size);
+	swap_table = bitmap_create(swap_slot_cnt);
+	swap_slots = calloc(swap_slot_cnt, sizeof *swap_slots);
+	plug_buf = palloc_get_multiple(0, SWAP_CLUSTER);
+	ra_buf = palloc_get_multiple(0, SWAP_CLUSTER);
+	if (swap_table == NULL || swap_slots == NULL || plug_buf == NULL || ra_buf == NULL)
+		PANIC("vm_anon_init: cannot allocate swap table");
+	for (size_t i = 0; i < SWAP_CACHE_PAGES; i++)
+		swap_cache[i].slot = -1;
+	lock_init(&swap_lock);
+	lock_init(&swap_io_lock);
+}
+
+/* anon_print_stats - 스왑이 쓰였다면 스왑 I/O 통계를 출력한다. */
+void
+anon_print_stats (void) {
+	if (swap_out_cnt == 0 && swap_in_cnt == 0)
+		return;
+	printf("Swap: %llu pages out in %llu writes, %llu pages in with %llu reads, "
+		   "%llu read ahead, %llu cache hits\n",
+		   (unsigned long long)swap_out_cnt, (unsigned long long)swap_write_cnt,
+		   (unsigned long long)swap_in_cnt, (unsigned long long)swap_read_cnt,
+		   (unsigned long long)readahead_cnt, (unsigned long long)swap_cache_hit_cnt);
+}
+
+/* in_plug - slot이 아직 쓰지 않은 묶음에 들어 있다면 true를 반환한다. swap_io_lock을 쥐고 호출한다. */
+static bool
+in_plug (int slot) {
+	return plug_cnt > 0 && slot >= plug_start && (size_t)(slot - plug_start) < plug_cnt;
+}
+
+/* swap_cache_find - slot을 담은 캐시 항목을 반환한다. 없다면 NULL. swap_io_lock을 쥐고 호출한다. */
+static struct swap_cache_entry *
+swap_cache_find (int slot) {
+	for (size_t i = 0; i < SWAP_CACHE_PAGES; i++)
+		if (swap_cache[i].slot == slot)
+			return &swap_cache[i];
+	return NULL;
+}
+
+/* swap_cache_insert - slot의 내용 kva를 캐시에 복사한다. 캐시가 가득 찼다면 돌아가며 하나를 내쫓는다.
+   캐시 페이지를 얻을 수 없다면 넣지 않는다. swap_io_lock을 쥐고 호출한다. */
+static void
+swap_cache_insert (int slot, const void *kva) {
+	struct swap_cache_entry *e = &swap_cache[swap_cache_hand];
+
+	swap_cache_hand = (swap_cache_hand + 1) % SWAP_CACHE_PAGES;
+	if (e->kva == NULL)
+		e->kva = palloc_get_page(0);
+	if (e->kva == NULL) {
+		e->slot = -1;
+		return;
+	}
+	copy_page(e->kva, kva);
+	e->slot = slot;
+}
+
+/* swap_slot_put - slot을 가리키던 페이지 하나가 더 이상 쓰지 않음을 기록하고, 아무도 쓰지 않으면 슬롯을 돌려준다.
+   아직 쓰지 않은 묶음에 든 슬롯은 묶음을 쓴 뒤에 돌려준다. */
+static void
+swap_slot_put (int slot) {
+	struct swap_cache_entry *e;
+
+	lock_acquire(&swap_io_lock);
+	lock_acquire(&swap_lock);
+	ASSERT(swap_slots[slot].refs > 0);
+	if (--swap_slots[slot].refs == 0) {
+		swap_slots[slot].ready = false;
+		if (!in_plug(slot))
+			bitmap_set(swap_table, slot, false);
+		e = swap_cache_find(slot);
+		if (e != NULL)
+			e->slot = -1;
+	}
+	lock_release(&swap_lock);
+	lock_release(&swap_io_lock);
+}
+
+/* swap_slot_alloc - 슬롯 하나를 배정해 반환한다. 스왑이 가득 찼다면 BITMAP_ERROR를 반환한다.
+   묶고 있는 중이라면 묶음의 바로 다음 슬롯을 먼저 시도한다. swap_io_lock을 쥐고 호출한다. */
+static size_t
+swap_slot_alloc (bool plugged) {
+	size_t slot = BITMAP_ERROR;
+
+	lock_acquire(&swap_lock);
+	if (plugged && plug_cnt > 0 && plug_cnt < SWAP_CLUSTER) {
+		size_t next = plug_start + plug_cnt;
+		if (next < swap_slot_cnt && !bitmap_test(swap_table, next)) {
+			bitmap_mark(swap_table, next);
+			slot = next;
+		}
+	}
+	if (slot == BITMAP_ERROR)
+		slot = bitmap_scan_and_flip_from_hint(swap_table, &swap_hint, 1, false);
+	if (slot != BITMAP_ERROR) {
+		swap_slots[slot].refs = 1;
+		swap_slots[slot].ready = false;
+	}
+	lock_release(&swap_lock);
+	return slot;
+}
+
+/* swap_slot_ready - 슬롯 slot의 내용을 다 썼음을 기록한다. 그 사이 비워졌다면 이제 돌려준다.
+   swap_io_lock을 쥐고 호출한다. */
+static void
+swap_slot_ready (int slot) {
+	lock_acquire(&swap_lock);
+	if (swap_slots[slot].refs == 0)
+		bitmap_set(swap_table, slot, false);
+	else
+		swap_slots[slot].ready = true;
+	lock_release(&swap_lock);
+}
+
+/* anon_swap_plug - 이 스레드가 anon_swap_unplug()를 부를 때까지 내보내는 익명 페이지들을 묶어서 쓴다.
+   kswapd처럼 여러 페이지를 잇달아 내보내는 스레드가 쓴다. 한 번에 한 스레드만 묶을 수 있다. */
+void
+anon_swap_plug (void) {
+	lock_acquire(&swap_io_lock);
+	if (plug_owner == NULL)
+		plug_owner = thread_current();
+	lock_release(&swap_io_lock);
+}
+
+/* anon_swap_unplug - 모아 둔 페이지들을 쓰고 묶기를 끝낸다. */
+void
+anon_swap_unplug (void) {
+	lock_acquire(&swap_io_lock);
+	if (plug_owner == thread_current()) {
+		swap_flush();
+		plug_owner = NULL;
+	}
+	lock_release(&swap_io_lock);
+}
+
+/* swap_flush - 모아 둔 페이지들을 명령 하나로 연속된 슬롯에 쓴다. swap_io_lock을 쥐고 호출한다. */
+static void
+swap_flush (void) {
+	if (plug_cnt == 0)
+		return;
+	disk_write_multiple(swap_disk, plug_start * SECTORS_PER_PAGE, plug_buf, plug_cnt * SECTORS_PER_PAGE);
+	swap_write_cnt++;
+	for (size_t i = 0; i < plug_cnt; i++)
+		swap_slot_ready(plug_start + i);
+	plug_cnt = 0;
+}
+
+/* ra_match - 슬롯 slot을 page와 함께 미리 읽을 만하다면 true를 반환한다.
+   다 쓰였고, 캐시에 없고, page와 같은 프로세스의 같은 VMA에 속한 페이지여야 한다.
+   swap_io_lock을 쥐고 호출한다. */
+static bool
+ra_match (size_t slot, struct page *page, struct vm_area *vma) {
+	struct swap_slot *s = &swap_slots[slot];
+
+	if (s->refs == 0 || !s->ready || s->pml4 != page->pml4 || swap_cache_find(slot) != NULL)
+		return false;
+	return vma_find(&thread_current()->spt.vmas, s->va) == vma;
+}
+
+/* swap_read - 슬롯 slot의 내용을 kva로 읽어 온다. 묶어 쓰는 중이거나 캐시에 있다면 메모리에서 복사하고,
+   아니라면 같은 클러스터에서 이웃한 page의 형제 슬롯들을 명령 하나로 함께 읽어 캐시에 둔다.
+   swap_io_lock을 쥐고 호출한다. */
+static void
+swap_read (int slot, struct page *page, void *kva) {
+	struct swap_cache_entry *e;
+	size_t lo = slot, hi = slot, base;
+
+	if (in_plug(slot)) {
+		copy_page(kva, plug_buf + (slot - plug_start) * PGSIZE);
+		swap_cache_hit_cnt++;
+		return;
+	}
+	e = swap_cache_find(slot);
+	if (e != NULL) {
+		copy_page(kva, e->kva);
+		swap_cache_hit_cnt++;
+		return;
+	}
+
+	// 폴트를 낸 프로세스의 페이지만 미리 읽는다. VMA는 현재 스레드의 것으로 찾는다.
+	if (page->pml4 == thread_current()->pml4) {
+		struct vm_area *vma = vma_find(&thread_current()->spt.vmas, page->va);
+
+		base = slot - slot % SWAP_CLUSTER;
+		lock_acquire(&swap_lock);
+		while (lo > base && ra_match(lo - 1, page, vma))
+			lo--;
+		while (hi + 1 < base + SWAP_CLUSTER && hi + 1 < swap_slot_cnt && ra_match(hi + 1, page, vma))
+			hi++;
+		lock_release(&swap_lock);
+	}
+
+	disk_read_multiple(swap_disk, lo * SECTORS_PER_PAGE, ra_buf, (hi - lo + 1) * SECTORS_PER_PAGE);
+	swap_read_cnt++;
+	copy_page(kva, ra_buf + (slot - lo) * PGSIZE);
+	for (size_t s = lo; s <= hi; s++)
+		if (s != (size_t)slot) {
+			swap_cache_insert(s, ra_buf + (s - lo) * PGSIZE);
+			readahead_cnt++;
+		}
 }
 
 /* Initialize the file mapping */
@@ -61,16 +321,34 @@ anon_swap_in (struct page *page, void *kva) {
 	*/
 	int find_slot = anon_page->swap_sector;
 
-	if(bitmap_test(swap_table, find_slot) == false){	//스왑 테이블에 해당 슬롯(섹터)가 있는지 확인
+	if(find_slot == -1 || bitmap_test(swap_table, find_slot) == false){	//스왑 테이블에 해당 슬롯(섹터)가 있는지 확인
 		return false;
 	}
 
-	for(int i = 0; i <SECTORS_PER_PAGE; i++){	//디스크로부터 읽어온다.
-		disk_read(swap_disk, find_slot *SECTORS_PER_PAGE+ i, kva + DISK_SECTOR_SIZE*i);
-	}
+	lock_acquire(&swap_io_lock);
+	swap_read(find_slot, page, kva);	//디스크나 캐시로부터 읽어온다.
+	swap_in_cnt++;
+	lock_release(&swap_io_lock);
+
+	swap_slot_put(find_slot);	//슬롯을 가리키는 페이지가 더 없다면 비어 있다고 표시
+	anon_page->swap_sector = -1;
+
+	return true;
+}
 
-	bitmap_set(swap_table,find_slot, false);	//해당 슬롯이 스왑인 되어있다는 표시
+/* anon_swap_share - 스왑에 나가 있는 페이지 src의 슬롯을 익명 페이지 dst도 가리키게 한다.
+   fork에서 부모의 스왑된 페이지를 물려줄 때와, 공유하던 프레임을 내보낼 때 쓴다.
+   슬롯은 가리키는 페이지가 모두 올라오거나 사라진 뒤에 비워진다. */
+bool
+anon_swap_share (struct page *dst, struct page *src) {
+	int slot = src->anon.swap_sector;
 
+	if (slot == -1)
+		return false;
+	lock_acquire(&swap_lock);
+	swap_slots[slot].refs++;
+	lock_release(&swap_lock);
+	dst->anon.swap_sector = slot;
 	return true;
 }
 
@@ -80,30 +358,56 @@ anon_swap_in (struct page *page, void *kva) {
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	bool plugged;
+	size_t empty_slot;
 
 	//swap table에서 page를 할당받을 수 있는 swap slot 찾기
-	//bitmap_scan : 비트맵에서 비트를 검색하여 주어진 범위에서 비트를 찾는다.
-	int empty_slot = bitmap_scan(swap_table, 0, 1, false);
+	//슬롯을 찾아 바로 사용 중으로 표시해야 다른 스레드가 같은 슬롯을 고르지 않는다.
+	lock_acquire(&swap_io_lock);
+	plugged = plug_owner == thread_current();
+	empty_slot = swap_slot_alloc(plugged);
 	if(empty_slot == BITMAP_ERROR){
+		lock_release(&swap_io_lock);
 		return false;
 	}
-	
+
 	/*
-	한 페이지를 디스크에 써주기 위해 SECTORS_PER_PAGE 개의 섹터에 저장해야 한다.
-	이때 디스크에 각 섹터 크기의 DISK_SECTOR_SIZE만큼 써준다.
+	kswapd처럼 다른 스레드가 내보낼 수도 있으므로 페이지를 가진 프로세스의 pml4를 쓰고,
+	쓰는 동안 프로세스가 내용을 바꾸지 못하도록 present bit를 먼저 0으로 바꿔준다.
+	이제 프로세스가 이 페이지에 접근하면 page fault가 뜨고, 교체가 끝날 때까지 기다린다.
+	2 MiB 매핑을 나누지 못했다면 매핑은 그대로이므로 슬롯을 돌려주고 실패한다.
 	*/
-	for(int i = 0; i <SECTORS_PER_PAGE; i++){
-		disk_write(swap_disk, empty_slot *SECTORS_PER_PAGE + i , page->va + DISK_SECTOR_SIZE * i);
+	if (!pml4_clear_page(page->pml4, page->va)) {
+		lock_acquire(&swap_lock);
+		swap_slots[empty_slot].refs = 0;
+		lock_release(&swap_lock);
+		swap_slot_ready(empty_slot);
+		lock_release(&swap_io_lock);
+		return false;
 	}
+	swap_slots[empty_slot].pml4 = page->pml4;
+	swap_slots[empty_slot].va = page->va;
 
 	/*
-	swap table의 해당 페이지에 대한 swap slot의 비트를 true로 바꿔주고
-	해당 페이지의 PTE에서 present bit를 0으로 바꿔준다.
-	이제 프로세스가 이 페이지에 접근하면 page fault가 뜬다.
+	한 페이지를 디스크에 써주기 위해 SECTORS_PER_PAGE 개의 섹터에 저장해야 한다.
+	묶고 있다면 연속된 슬롯이 이어지는 동안 버퍼에 모으고, 아니라면 명령 하나로 바로 쓴다.
+	사용자 주소는 현재 스레드의 주소 공간이 아닐 수 있으므로 프레임의 커널 주소에서 읽는다.
 	*/
-
-	bitmap_set(swap_table, empty_slot, true); //스왑 테이블에서 해당 스왑 슬롯을 사용 중으로 설정한다.
-	pml4_clear_page(thread_current()->pml4, page->va);
+	if (plugged) {
+		if (plug_cnt > 0 && (size_t)(plug_start + plug_cnt) != empty_slot)
+			swap_flush();
+		if (plug_cnt == 0)
+			plug_start = empty_slot;
+		copy_page(plug_buf + plug_cnt * PGSIZE, page->frame->kva);
+		if (++plug_cnt == SWAP_CLUSTER)
+			swap_flush();
+	} else {
+		disk_write_multiple(swap_disk, empty_slot * SECTORS_PER_PAGE, page->frame->kva, SECTORS_PER_PAGE);
+		swap_write_cnt++;
+		swap_slot_ready(empty_slot);
+	}
+	swap_out_cnt++;
+	lock_release(&swap_io_lock);
 
 	//페이지에 대한 스왑 인덱스 값을 이 페이지가 저장된 swap slot의 번호로 써준다.
 	anon_page->swap_sector = empty_slot;
@@ -116,4 +420,8 @@ anon_swap_out (struct page *page) {
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	//스왑에 나가 있는 페이지라면 슬롯을 돌려준다.
+	if (anon_page->swap_sector != -1)
+		swap_slot_put(anon_page->swap_sector);
 }
@@ -4,6 +4,7 @@
 #include "vm/vm.h"
 #include "userprog/process.h"
 #include "threads/vaddr.h"
+#include "threads/mmu.h"
 #include "vm/file.h"
 #include "userprog/syscall.h"
 
@@ -81,9 +82,26 @@ static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
 
+	struct lazy_load_arg *file_aux = (struct lazy_load_arg *)file_page->aux;
+	struct frame *frame = page->frame;
+
+	//kswapd처럼 다른 스레드가 내보낼 수도 있으므로 페이지를 가진 프로세스의 pml4와 프레임의 커널 주소를 쓴다.
+	//쓰는 동안 내용이 바뀌지 않도록 먼저 매핑을 끊는다. dirty 비트는 남아 있다.
+	//매핑을 끊지 못했다면(2 MiB 매핑을 나눌 메모리가 없는 경우) 아무것도 바꾸지 않고 실패한다.
+	if (!pml4_clear_page(page->pml4, page->va))
+		return false;
+
 	//page가 수정되었다면 file에 수정사항을 기록하면서 swap out 시킨다.
-	//dirty check
-	file_backed_destroy(page);	
+	//파일 시스템 호출 중의 폴트에서 직접 교체하는 경우에는 이미 filesys_lock을 쥐고 있다.
+	if(pml4_is_dirty(page->pml4, page->va)){
+		bool held = lock_held_by_current_thread(&filesys_lock);
+		if (!held)
+			lock_acquire(&filesys_lock);
+		file_write_at(file_aux->file, frame->kva, file_aux->read_bytes, file_aux->ofs);
+		if (!held)
+			lock_release(&filesys_lock);
+		pml4_set_dirty(page->pml4, page->va, 0);
+	}
 	
 	return true;
 }
@@ -118,26 +136,12 @@ do_mmap (void *addr, size_t length, int writable,
 	ASSERT(pg_ofs(addr) == 0);	  // upage가 페이지 정렬되어 있는지 확인
 	ASSERT(offset % PGSIZE == 0); // ofs가 페이지 정렬되어 있는지 확인
 
-	while (read_bytes > 0 || zero_bytes > 0)
+	// 매핑 전체를 영역 하나로 등록한다. 페이지는 처음 접근할 때 만들어지므로 길이와 관계없이 비용이 같다.
+	if (vma_create(&thread_current()->spt.vmas, addr, addr + read_bytes + zero_bytes, VM_FILE,
+				   writable, lazy_load_segment, re_file, offset, read_bytes) == NULL)
 	{
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
-		lazy_load_arg->file = re_file;
-		lazy_load_arg->ofs = offset;
-		lazy_load_arg->read_bytes = page_read_bytes;
-		lazy_load_arg->zero_bytes = page_zero_bytes;
-
-		// vm_alloc_page_with_initializer를 호출하여 대기 중인 객체를 생성합니다.
-		if (!vm_alloc_page_with_initializer(VM_FILE, addr,
-											writable, lazy_load_segment, lazy_load_arg))
-			return NULL;
-
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		addr += PGSIZE;
-		offset += page_read_bytes;
+		file_close(re_file);
+		return NULL;
 	}
 
 	return start_addr;
@@ -147,21 +151,25 @@ do_mmap (void *addr, size_t length, int writable,
 /*연결된 물리프레임과의 연결을 끊어준다.*/
 void
 do_munmap (void *addr) {
+	struct thread *curr = thread_current();
+	struct vm_area *vma = vma_find(&curr->spt.vmas, addr);
+
+	if (vma == NULL || vma->type != VM_FILE)
+		return;
 
-	while(true){
-		struct thread *curr = thread_current();
+	//접근한 적이 없는 페이지는 spt에 없으므로 영역의 끝까지 본다.
+	for (; addr < vma->end; addr += PGSIZE) {
 		struct page *find_page = spt_find_page(&curr->spt, addr);
 		
-		if (find_page == NULL) {
-    		return NULL;
-    	}
+		if (find_page == NULL)
+			continue;
 
 		struct lazy_load_arg* container = (struct lazy_load_arg*)find_page->uninit.aux;
 		find_page->file.aux = container;
 
 		file_backed_destroy(find_page);
-		addr += PGSIZE;
 	}
+	vma_remove(&curr->spt.vmas, vma);
 }
 
 // void
@@ -1,5 +1,6 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
@@ -8,12 +9,54 @@
 #include "threads/vaddr.h"
 #include "threads/mmu.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #include "userprog/process.h"
 
 // 프레임 구조체를 관리하는 frame_table
 struct list frame_table;
 struct list_elem * clock_ref;
 struct lock frame_table_lock;
+// pinned가 풀린 프레임이 있을 때 알린다. frame_table_lock과 함께 쓴다.
+static struct condition frame_unpinned;
+
+/* 백그라운드 회수(kswapd).
+ * 사용자 풀의 빈 페이지가 kswapd_low 아래로 내려가면 kswapd 워크큐의 회수 작업을 깨우고,
+ * 작업은 빈 페이지가 kswapd_high에 이를 때까지 페이지를 내보내 프레임을 풀에 돌려준다.
+ * 스왑 쓰기는 kswapd가 하므로 폴트를 처리하는 스레드는 풀이 완전히 비었을 때만 직접 교체한다. */
+static struct workqueue kswapd_wq;
+static struct work kswapd_work;
+static size_t kswapd_low, kswapd_high;
+static uint64_t kswapd_reclaim_cnt;		// kswapd가 돌려준 프레임 수
+static uint64_t direct_reclaim_cnt;		// 폴트 중에 직접 교체한 프레임 수
+static void kswapd_work_func(struct work *work);
+
+// 교체 정책(CLOCK) 통계
+static uint64_t clock_scan_cnt;		// 시곗바늘이 살펴본 프레임 수
+static uint64_t clock_clear_cnt;	// accessed 비트를 끈 횟수
+static uint64_t clean_evict_cnt;	// 쓰지 않고 버린 프레임 수
+static uint64_t dirty_evict_cnt;	// 스왑이나 파일에 써야 했던 프레임 수
+
+// copy-on-write 통계
+static uint64_t cow_share_cnt;	// fork에서 복사하지 않고 공유한 페이지 수
+static uint64_t cow_copy_cnt;	// 처음 쓸 때 복사한 페이지 수
+
+// 자주 만들고 없애는 VM 객체들을 위한 슬랩 캐시
+static struct kmem_cache page_cache;
+static struct kmem_cache frame_cache;
+static struct kmem_cache lazy_load_arg_cache;
+
+// 2 MiB 큰 페이지 하나에 들어가는 4 KiB 페이지 수
+#define HPAGE_PAGES (HPGSIZE / PGSIZE)
+
+// vm_evict_frame()이 swap_out에 실패한 희생자를 건너뛰고 다시 고르는 최대 횟수
+#define EVICT_TRIES 8
+
+/* -o thp: 큰 익명 영역을 2 MiB 페이지로 매핑하는가? */
+bool thp_enabled;
+
+// 투명 큰 페이지 통계
+static uint64_t thp_fault_cnt;		// 2 MiB 페이지로 처리한 폴트 수
+static uint64_t thp_fallback_cnt;	// 영역은 알맞았지만 정렬된 프레임이 없어 4 KiB로 처리한 폴트 수
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes.W
@@ -31,7 +74,20 @@ void vm_init(void)
 	/* TODO: Your code goes here. */
 	list_init(&frame_table);
 	clock_ref = list_begin(&frame_table);
-	lock_init(&frame_table_lock);
+	lock_init_named(&frame_table_lock, "frame_table");
+	cond_init(&frame_unpinned);
+	kmem_cache_create(&page_cache, "page", sizeof(struct page), NULL);
+	kmem_cache_create(&frame_cache, "frame", sizeof(struct frame), NULL);
+	kmem_cache_create(&lazy_load_arg_cache, "lazy_load_arg", sizeof(struct lazy_load_arg), NULL);
+	vma_init();
+
+	// 사용자 풀의 1/32을 low, 그 두 배를 high 워터마크로 둔다.
+	kswapd_low = palloc_page_cnt(PAL_USER) / 32;
+	if (kswapd_low < 4)
+		kswapd_low = 4;
+	kswapd_high = kswapd_low * 2;
+	work_init(&kswapd_work, kswapd_work_func);
+	workqueue_create(&kswapd_wq, "kswapd", 1, PRI_DEFAULT);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -57,6 +113,10 @@ page_get_type(struct page *page)
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
 static struct frame *vm_evict_frame(void);
+static bool vm_claim_huge(struct page *page, bool *handled);
+static void frame_unpin(struct frame *frame);
+static void frame_unlink(struct frame *frame);
+static struct page *spt_populate(struct supplemental_page_table *spt, void *va);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -86,7 +146,7 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		 * uninit_new를 호출한 후에 필드를 수정해야 합니다.
 		 */
 
-		struct page *page = (struct page *)malloc(sizeof(struct page));
+		struct page *page = kmem_cache_alloc(&page_cache);
 		if (page == NULL)
 		{
 			return false;
@@ -104,11 +164,12 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		}
 		if (new_initializer == NULL)
 		{
-			free(page);
+			kmem_cache_free(&page_cache, page);
 			return false;
 		}
 		uninit_new(page, upage, init, type, aux, new_initializer);
 		page->writable = writable;
+		page->pml4 = thread_current()->pml4;
 
 		/* TODO: Insert the page into the spt. */
 		/* 페이지를 spt에 삽입합니다. */
@@ -123,27 +184,49 @@ err:
 struct page *
 spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED)
 {
-	struct page *page = malloc(sizeof(struct page));
+	// 해시는 va만 보므로 스택에 둔 페이지를 키로 써서 할당 없이 찾는다.
+	struct page key;
 	struct hash_elem *e;
-	if (page == NULL)
-	{
-		return NULL;
-	}
 
-	page->va = pg_round_down(va);
-	e = hash_find(&spt->hash_table, &page->hash_elem);
+	key.va = pg_round_down(va);
+	e = hash_find(&spt->hash_table, &key.hash_elem);
+	return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
+}
 
-	if (e != NULL)
+/* spt_populate - va를 담는 영역(VMA)에서 va의 페이지를 처음으로 만들어 spt에 넣고 반환한다.
+ * 영역이 없거나 메모리가 없다면 NULL을 반환한다.
+ * 영역은 한 번에 등록하고 페이지는 처음 접근할 때 만들므로, 큰 mmap도 등록 비용은 상수이다.
+ */
+static struct page *
+spt_populate(struct supplemental_page_table *spt, void *va)
+{
+	struct vm_area *vma = vma_find(&spt->vmas, va);
+	struct lazy_load_arg *aux = NULL;
+	size_t ofs;
+
+	if (vma == NULL)
+		return NULL;
+
+	va = pg_round_down(va);
+	ofs = (uint8_t *)va - (uint8_t *)vma->start;
+	if (vma->file != NULL)
 	{
-		struct page *found_page = hash_entry(e, struct page, hash_elem);
-		free(page);
-		return found_page;
+		aux = kmem_cache_alloc(&lazy_load_arg_cache);
+		if (aux == NULL)
+			return NULL;
+		aux->file = vma->file;
+		aux->ofs = vma->ofs + ofs;
+		aux->read_bytes = ofs < vma->read_bytes ? vma->read_bytes - ofs : 0;
+		if (aux->read_bytes > PGSIZE)
+			aux->read_bytes = PGSIZE;
+		aux->zero_bytes = PGSIZE - aux->read_bytes;
 	}
-	else
+	if (!vm_alloc_page_with_initializer(vma->type, va, vma->writable, vma->init, aux))
 	{
-		free(page);
+		kmem_cache_free(&lazy_load_arg_cache, aux);
 		return NULL;
 	}
+	return spt_find_page(spt, va);
 }
 
 /* Insert PAGE into spt with validation. */
@@ -152,14 +235,9 @@ bool spt_insert_page(struct supplemental_page_table *spt UNUSED, struct page *pa
 {
 	int succ = false;
 
+	// hash_insert()는 같은 va의 페이지가 이미 있다면 넣지 않고 그 페이지를 반환한다.
 	if (is_user_vaddr(page->va))
-	{
-		if (spt_find_page(spt, page->va) == NULL)
-		{
-			hash_insert(&spt->hash_table, &page->hash_elem);
-			succ = true;
-		}
-	}
+		succ = hash_insert(&spt->hash_table, &page->hash_elem) == NULL;
 	return succ;
 }
 
@@ -170,55 +248,212 @@ void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 	return true;
 }
 
+/* frame_map - page가 frame을 매핑함을 frame의 역매핑(rmap)에 기록한다. 처음 매핑하는 페이지는 frame을 대표한다.
+   frame_table_lock을 쥔 상태에서 호출되어야 한다. */
+static void
+frame_map(struct frame *frame, struct page *page)
+{
+	list_push_back(&frame->rmap, &page->rmap_elem);
+	frame->ref_cnt++;
+	if (frame->page == NULL)
+		frame->page = page;
+	page->frame = frame;
+}
+
+/* frame_put - page가 frame을 더 이상 매핑하지 않음을 기록한다. 아무 페이지도 매핑하지 않게 되면 프레임을 해제한다.
+   frame이 page를 대표하고 있었다면 남은 페이지 중 하나가 대표가 된다.
+   frame_table_lock을 쥔 상태에서 호출되어야 한다. */
+static void
+frame_put(struct frame *frame, struct page *page)
+{
+	ASSERT(frame->ref_cnt > 0);
+
+	list_remove(&page->rmap_elem);
+	page->frame = NULL;
+	if (--frame->ref_cnt == 0)
+	{
+		frame_unlink(frame);
+		palloc_free_page(frame->kva);
+		kmem_cache_free(&frame_cache, frame);
+		return;
+	}
+	if (frame->page == page)
+		frame->page = list_entry(list_front(&frame->rmap), struct page, rmap_elem);
+}
+
+/* frame_test_and_clear_accessed - frame을 매핑한 모든 (pml4, va)의 accessed 비트를 보고 끈다.
+   하나라도 켜져 있었다면 true를 반환한다.
+   2 MiB 매핑의 512 프레임은 페이지 디렉토리 항목의 accessed 비트 하나를 같이 쓰므로 CLOCK에서 한 단위로 다룬다.
+   vm_claim_huge()가 frame_table에 차례로 넣은 마지막 프레임에서만 비트를 끄므로,
+   한 바퀴 동안 앞의 511 프레임도 같은 비트를 보고 함께 두 번째 기회를 얻는다. */
+static bool
+frame_test_and_clear_accessed(struct frame *frame)
+{
+	bool accessed = false;
+	struct list_elem *e;
+
+	for (e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e))
+	{
+		struct page *p = list_entry(e, struct page, rmap_elem);
+
+		if (pml4_is_accessed(p->pml4, p->va))
+		{
+			if (!pml4_is_huge(p->pml4, p->va) || ((uint64_t)p->va & HPGMASK) == HPGSIZE - PGSIZE)
+				pml4_set_accessed(p->pml4, p->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* frame_is_clean - frame을 내보낼 때 아무것도 쓸 필요가 없다면 true를 반환한다.
+   수정되지 않은 파일 페이지만 그렇다. 익명 페이지는 언제나 스왑에 써야 한다. */
+static bool
+frame_is_clean(struct frame *frame)
+{
+	struct page *page = frame->page;
+
+	return VM_TYPE(page->operations->type) == VM_FILE && !pml4_is_dirty(page->pml4, page->va);
+}
+
 /* Get the struct frame, that will be evicted. */
-/* 페이지를 교체할 프레임을 가져옵니다. */
+/* 페이지를 교체할 프레임을 가져옵니다.
+   모든 프로세스의 프레임이 들어 있는 frame_table을 clock_ref부터 도는 전역 CLOCK이다.
+   accessed 비트가 켜진 프레임은 역매핑의 모든 매핑에서 비트를 끄고 넘어가고(두 번째 기회),
+   꺼진 프레임 중에서는 쓰지 않고 버릴 수 있는 깨끗한 프레임을 먼저 고른다.
+   꺼진 더러운 프레임은 후보로 기억해 두었다가, 한 바퀴를 더 돌아도 깨끗한 프레임이 없으면 고른다.
+   pinned인 프레임은 건너뛰며, 두 바퀴를 돌아도 고를 프레임이 없다면 NULL을 반환한다.
+   frame_table_lock을 쥔 상태에서 호출되어야 한다. */
 static struct frame *
 vm_get_victim(void)
 {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
-	struct thread* curr = thread_current();
-	lock_acquire(&frame_table_lock);
-	for (clock_ref; clock_ref != list_end(&frame_table); clock_ref = list_next(clock_ref)){
-		victim = list_entry(clock_ref,struct frame,frame_elem);
-		//bit가 1인 경우
-		if(pml4_is_accessed(curr->pml4,victim->page->va)){
-			pml4_set_accessed(curr->pml4,victim->page->va,0);
-		}else{
-			lock_release(&frame_table_lock);
-			return victim;
+	size_t size = list_size(&frame_table);
+	size_t cnt = size * 2;
+	struct frame *dirty = NULL;
+	size_t dirty_left = 0;
+
+	while (cnt-- > 0)
+	{
+		struct frame *victim;
+
+		if (clock_ref == list_end(&frame_table))
+			clock_ref = list_begin(&frame_table);
+		victim = list_entry(clock_ref, struct frame, frame_elem);
+		clock_ref = list_next(clock_ref);
+		clock_scan_cnt++;
+
+		// 더러운 후보를 찾은 뒤 한 바퀴를 돌았다면 그 프레임을 고른다.
+		if (dirty != NULL && dirty_left-- == 0)
+			break;
+		if (victim->pinned || victim->page == NULL)
+			continue;
+		if (frame_test_and_clear_accessed(victim))
+		{
+			clock_clear_cnt++;
+			continue;
 		}
-	}
-	struct list_elem* start = list_begin(&frame_table);
-
-	for (start; start != list_end(&frame_table); start = list_next(start)){
-		victim = list_entry(start,struct frame,frame_elem);
-		//bit가 1인 경우
-		if(pml4_is_accessed(curr->pml4,victim->page->va)){
-			pml4_set_accessed(curr->pml4,victim->page->va,0);
-		}else{
-			lock_release(&frame_table_lock);
+		if (frame_is_clean(victim))
 			return victim;
+		if (dirty == NULL)
+		{
+			dirty = victim;
+			dirty_left = size;
 		}
 	}
+	if (dirty != NULL)
+		clock_ref = list_next(&dirty->frame_elem);
+	return dirty;
+}
 
+/* frame_unlink - frame을 frame_table에서 뺀다. 시곗바늘이 frame을 가리키고 있었다면 다음 프레임으로 옮긴다.
+   frame_table_lock을 쥔 상태에서 호출되어야 한다. */
+static void
+frame_unlink(struct frame *frame)
+{
+	if (clock_ref == &frame->frame_elem)
+		clock_ref = list_next(clock_ref);
+	list_remove(&frame->frame_elem);
+}
+
+/* frame_unpin - 페이지를 올리거나 내보내는 일이 끝난 frame을 다시 교체 대상으로 두고 기다리던 스레드를 깨운다. */
+static void
+frame_unpin(struct frame *frame)
+{
+	lock_acquire(&frame_table_lock);
+	frame->pinned = false;
+	cond_broadcast(&frame_unpinned, &frame_table_lock);
 	lock_release(&frame_table_lock);
-	ASSERT(clock_ref != NULL);
-	return victim;
 }
 
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
-/* 페이지를 교체하고 해당 프레임을 반환합니다.
- * 에러인 경우 NULL을 반환합니다. */
-
+/* 페이지를 교체하고 frame_table에서 뺀 프레임을 반환합니다.
+ * 희생자의 swap_out이 실패하면(스왑이 가득 찼거나 2 MiB 매핑을 나눌 페이지 테이블을 얻지 못한 경우)
+ * 그 희생자는 건너뛰고 EVICT_TRIES번까지 다른 희생자를 고릅니다.
+ * 교체할 프레임이 없거나 모두 실패하면 NULL을 반환합니다.
+ * 내보내는 동안 프레임은 pinned로 두어, 다른 스레드가 같은 프레임을 고르거나
+ * 주인 프로세스가 종료하며 프레임을 해제하지 않게 합니다.
+ * 여러 프로세스가 공유하는(copy-on-write) 프레임은 대표 페이지의 swap_out으로 한 번 쓰고,
+ * 나머지 페이지들은 역매핑으로 찾아 매핑을 끊고 같은 스왑 슬롯을 가리키게 합니다. */
 static struct frame *
 vm_evict_frame(void)
 {
-	struct frame *victim UNUSED = vm_get_victim();
-	/* TODO: swap out the victim and return the evicted frame. */
-	/* 희생자를 교체하고 교체된 프레임을 반환합니다. */
-	swap_out(victim->page);
+	struct frame *victim;
+	struct page *page;
+	bool clean;
+	bool succ = false;
+
+	for (int tries = 0; !succ && tries < EVICT_TRIES; tries++)
+	{
+		lock_acquire(&frame_table_lock);
+		victim = vm_get_victim();
+		if (victim != NULL)
+		{
+			victim->pinned = true;
+			clean = frame_is_clean(victim);
+		}
+		lock_release(&frame_table_lock);
+		if (victim == NULL)
+			return NULL;
+
+		/* 희생자를 교체하고 교체된 프레임을 반환합니다. 실패하면 CLOCK 바늘이 이미 지나갔으므로 다음 희생자를 고릅니다. */
+		page = victim->page;
+		succ = swap_out(page);
+		if (!succ)
+		{
+			lock_acquire(&frame_table_lock);
+			victim->pinned = false;
+			cond_broadcast(&frame_unpinned, &frame_table_lock);
+			lock_release(&frame_table_lock);
+		}
+	}
+	if (!succ)
+		return NULL;
+
+	lock_acquire(&frame_table_lock);
+	while (!list_empty(&victim->rmap))
+	{
+		struct page *p = list_entry(list_pop_front(&victim->rmap), struct page, rmap_elem);
+
+		if (p != page)
+		{
+			// 공유하는 매핑은 cow_share()가 4 KiB로 만들어 두었으므로 나눌 필요가 없어 실패하지 않는다.
+			ASSERT(VM_TYPE(p->operations->type) == VM_ANON);
+			pml4_clear_page(p->pml4, p->va);
+			anon_swap_share(p, page);
+		}
+		p->frame = NULL;
+	}
+	victim->ref_cnt = 0;
+	victim->page = NULL;
+	frame_unlink(victim);
+	if (clean)
+		clean_evict_cnt++;
+	else
+		dirty_evict_cnt++;
+	victim->pinned = false;
+	cond_broadcast(&frame_unpinned, &frame_table_lock);
+	lock_release(&frame_table_lock);
 	return victim;
 }
 
@@ -227,48 +462,144 @@ vm_evict_frame(void)
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
 /* palloc() 및 프레임을 가져옵니다. 사용 가능한 페이지가 없는 경우 페이지를
- * 교체하고 반환합니다. 이 함수는 항상 유효한 주소를 반환합니다. 즉, 사용자 풀
- * 메모리가 가득 찬 경우 이 함수는 사용 가능한 메모리 공간을 얻기 위해 프레임을
- * 교체합니다. */
+ * 교체하고 반환합니다. 즉, 사용자 풀 메모리가 가득 찬 경우 이 함수는 사용 가능한
+ * 메모리 공간을 얻기 위해 프레임을 교체합니다. 교체할 수도 없다면 NULL을 반환합니다.
+ * 반환된 프레임은 아무 페이지도 매핑하지 않은 채 frame_table에 들어 있으며, 호출자가 frame_map()으로
+ * 페이지를 잇고 내용을 다 올릴 때까지 교체되지 않도록 pinned 상태이다. */
 
 static struct frame *
 vm_get_frame(void)
 {
-	struct frame *frame = (struct frame*)malloc(sizeof(struct frame)); // user_pool 에서 frame 가져오고, kva return해서 frame에 넣어준다.
-	/* TODO: Fill this function. */
-	frame->kva = palloc_get_page(PAL_USER);
-	
-	if(frame->kva == NULL){ //frame에서 가용한 page가 없다면
-		/* 해당 로직은 evict한 frame을 받아오기에 이미 Frame_Table 존재해서 list_push_back()할 필요 없음 */
-		frame = vm_evict_frame(); // 쫓아냄
-		frame->page = NULL;
-		//free(frame);
-		// PANIC("todo);
-		return frame;
+	struct frame *frame;
+	void *kva = palloc_get_page(PAL_USER); // user_pool 에서 페이지를 가져온다.
+
+	// 빈 페이지가 low 워터마크 아래로 내려갔다면 kswapd가 미리 회수하도록 깨운다.
+	if (kva == NULL || palloc_free_cnt(PAL_USER) < kswapd_low)
+		queue_work(&kswapd_wq, &kswapd_work);
+
+	if (kva == NULL)
+	{
+		// 풀이 완전히 비었을 때만 폴트를 처리하는 스레드가 직접 교체한다.
+		frame = vm_evict_frame();
+		if (frame == NULL)
+			return NULL;
+		direct_reclaim_cnt++;
+	}
+	else
+	{
+		// 새 페이지를 얻었을 때만 frame 구조체를 할당한다. 교체된 frame은 재사용하므로 할당하지 않는다.
+		frame = kmem_cache_alloc(&frame_cache);
+		if (frame == NULL)
+		{
+			palloc_free_page(kva);
+			return NULL;
+		}
+		frame->kva = kva;
 	}
+	frame->page = NULL; //새 frame을 가져왔으니 page의 멤버를 초기화
+	list_init(&frame->rmap);
+	frame->pinned = true;
+	frame->ref_cnt = 0;
 
 	lock_acquire(&frame_table_lock);
 	list_push_back(&frame_table,&frame->frame_elem);
 	lock_release(&frame_table_lock);
-	frame->page = NULL; //새 frame을 가져왔으니 page의 멤버를 초기화
-	
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
 	return frame;
 }
-/* 스택을 확장합니다. */
+
+/* kswapd_work_func - 사용자 풀의 빈 페이지가 kswapd_high에 이를 때까지 페이지를 내보내고 프레임을 풀에 돌려준다.
+ * 내보낼 프레임이 없거나 스왑이 가득 찼다면 멈추며, 다음 할당이 low 아래에서 다시 깨운다.
+ * 잇달아 내보내는 익명 페이지들은 연속된 스왑 슬롯에 묶어서 쓴다.
+ */
+static void
+kswapd_work_func(struct work *work UNUSED)
+{
+	anon_swap_plug();
+	while (palloc_free_cnt(PAL_USER) < kswapd_high)
+	{
+		struct frame *frame = vm_evict_frame();
+
+		if (frame == NULL)
+			break;
+		palloc_free_page(frame->kva);
+		kmem_cache_free(&frame_cache, frame);
+		kswapd_reclaim_cnt++;
+	}
+	anon_swap_unplug();
+}
+
+/* 스택을 확장합니다.
+   setup_stack()이 만든 스택 영역(VMA)의 시작을 addr의 페이지까지 내린다.
+   페이지는 다른 영역처럼 spt_populate()가 처음 접근할 때 만든다.
+   늘어날 자리에 mmap 같은 다른 영역이 있다면 늘리지 않는다. */
 static void
 vm_stack_growth(void *addr UNUSED)
 {
-	vm_alloc_page(VM_ANON | VM_MARKER_0, pg_round_down(addr), true);
+	struct vma_tree *vmas = &thread_current()->spt.vmas;
+	struct vm_area *stack = vma_find(vmas, (uint8_t *)USER_STACK - PGSIZE);
+
+	if (stack != NULL)
+		vma_grow_down(vmas, stack, pg_round_down(addr));
 }
 
 /* Handle the fault on write_protected page */
-/* 쓰기 보호된 페이지에 대한 처리 */
+/* 쓰기 보호된 페이지에 대한 처리
+   fork 뒤 부모와 자식이 읽기 전용으로 공유하는 프레임(copy-on-write)에 처음 쓸 때 불린다.
+   프레임을 매핑한 페이지가 이 페이지뿐이라면 그대로 쓰기 가능하게 바꾸고,
+   아니라면 새 프레임에 내용을 복사해 이 페이지만 옮긴다. */
 static bool
-vm_handle_wp(struct page *page UNUSED)
+vm_handle_wp(struct page *page)
 {
-	return false;
+	struct thread *curr = thread_current();
+	struct frame *old, *new;
+
+	lock_acquire(&frame_table_lock);
+	while (page->frame != NULL && page->frame->pinned)
+		cond_wait(&frame_unpinned, &frame_table_lock);
+	old = page->frame;
+	if (old == NULL)
+	{
+		// 기다리는 동안 스왑으로 나갔다. 다시 접근하면 not present 폴트로 올라온다.
+		lock_release(&frame_table_lock);
+		return true;
+	}
+	if (old->ref_cnt == 1)
+	{
+		bool succ = pml4_set_page(curr->pml4, page->va, old->kva, true);
+		lock_release(&frame_table_lock);
+		return succ;
+	}
+	// 복사하는 동안 old가 내보내지지 않도록 잡아 둔다.
+	old->pinned = true;
+	lock_release(&frame_table_lock);
+
+	new = vm_get_frame();
+	if (new == NULL)
+	{
+		frame_unpin(old);
+		return false;
+	}
+	copy_page(new->kva, old->kva);
+	if (!pml4_set_page(curr->pml4, page->va, new->kva, true))
+	{
+		lock_acquire(&frame_table_lock);
+		frame_unlink(new);
+		lock_release(&frame_table_lock);
+		palloc_free_page(new->kva);
+		kmem_cache_free(&frame_cache, new);
+		frame_unpin(old);
+		return false;
+	}
+
+	lock_acquire(&frame_table_lock);
+	old->pinned = false;
+	cond_broadcast(&frame_unpinned, &frame_table_lock);
+	frame_put(old, page);
+	frame_map(new, page);
+	lock_release(&frame_table_lock);
+	frame_unpin(new);
+	cow_copy_cnt++;
+	return true;
 }
 
 /* Return true on success */
@@ -320,12 +651,38 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 			vm_stack_growth(addr);
 
 		page = spt_find_page(spt, addr);
+		if (page == NULL)
+			page = spt_populate(spt, addr);
 		if (page == NULL)
 			return false;
 		if (write == 1 && page->writable == 0) // write 불가능한 페이지에 write 요청한 경우
 			return false;
+
+		// 다른 스레드가 이 페이지를 내보내는 중이라면 끝날 때까지 기다린다.
+		lock_acquire(&frame_table_lock);
+		while (page->frame != NULL && page->frame->pinned)
+			cond_wait(&frame_unpinned, &frame_table_lock);
+		lock_release(&frame_table_lock);
+
+		if (thp_enabled)
+		{
+			bool handled = false;
+			bool succ = vm_claim_huge(page, &handled);
+			if (handled)
+				return succ;
+		}
 		return vm_do_claim_page(page);
 	}
+
+	// 읽기 전용으로 매핑된 페이지에 쓰려고 한 경우: copy-on-write로 공유 중인 쓰기 가능한 페이지라면 복사한다.
+	// CR0.WP가 켜져 있으므로 read() 같은 시스템 콜에서 커널이 유저 버퍼에 쓰는 경우(user == false)도 여기로 온다.
+	if (write)
+	{
+		page = spt_find_page(spt, addr);
+		// 폴트와 이 검사 사이에 kswapd가 프레임을 내보냈을 수 있으므로 frame은 vm_handle_wp()가 확인한다.
+		if (page != NULL && page->writable)
+			return vm_handle_wp(page);
+	}
 	return false;
 }
 
@@ -336,7 +693,7 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 void vm_dealloc_page(struct page *page)
 {
 	destroy(page);
-	free(page);
+	kmem_cache_free(&page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -347,6 +704,8 @@ bool vm_claim_page(void *va UNUSED)
 
 	/* 물리 프레임과 연결을 할 페이지를 SPT를 통해서 찾아준다.*/
 	page = spt_find_page(&thread_current()->spt, va);
+	if (page == NULL)
+		page = spt_populate(&thread_current()->spt, va);
 
 	if (page == NULL)
 		return false;
@@ -368,8 +727,9 @@ vm_do_claim_page(struct page *page)
 	}
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	lock_acquire(&frame_table_lock);
+	frame_map(frame, page);
+	lock_release(&frame_table_lock);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 	/* 페이지 테이블 항목을 삽입하여 페이지의 VA를 프레임의 PA에 매핑합니다. */
@@ -379,12 +739,142 @@ vm_do_claim_page(struct page *page)
 	{
 		if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable))
 		{
+			lock_acquire(&frame_table_lock);
+			frame_put(frame, page);
+			lock_release(&frame_table_lock);
 			vm_dealloc_page(page);
 			return false;
 		}
 	}
 	/* 해당 페이지를 물리 메모리에 올려준다.*/
-	return swap_in(page, frame->kva);
+	bool succ = swap_in(page, frame->kva);
+	frame_unpin(frame);
+	return succ;
+}
+
+/* thp_eligible - base에서 시작하는 정렬된 2 MiB 영역을 큰 페이지 하나로 매핑할 수 있다면 true를 반환한다.
+ * 영역 전체가 쓰기 가능 여부가 writable인 익명 VMA 하나에 들어 있어야 하고,
+ * 이미 만들어진 페이지는 아직 한 번도 올라오지 않은(uninit) 페이지이며 매핑되어 있지 않아야 한다.
+ */
+static bool thp_eligible(struct thread *curr, uint8_t *base, bool writable)
+{
+	struct vm_area *vma = vma_find(&curr->spt.vmas, base);
+
+	if (vma == NULL || VM_TYPE(vma->type) != VM_ANON || vma->writable != writable || (uint8_t *)vma->end < base + HPGSIZE)
+		return false;
+
+	for (size_t i = 0; i < HPAGE_PAGES; i++)
+	{
+		void *va = base + i * PGSIZE;
+		struct page *p = spt_find_page(&curr->spt, va);
+
+		if (p != NULL && (VM_TYPE(p->operations->type) != VM_UNINIT || p->frame != NULL))
+			return false;
+		if (pml4_get_page(curr->pml4, va) != NULL)
+			return false;
+	}
+	return true;
+}
+
+/* vm_claim_huge - page가 들어 있는 정렬된 2 MiB 영역 전체를 물리적으로 연속된 512 페이지에 올리고
+ * 큰 페이지 하나로 매핑한다. 영역이 알맞지 않거나 메모리가 없다면 아무것도 바꾸지 않고 *handled를 false로 둔다.
+ * 매핑했다면 *handled를 true로 하고, 모든 페이지의 swap_in이 성공했는지를 반환한다.
+ *
+ * 페이지마다 struct frame을 따로 두므로 교체 정책은 4 KiB 페이지와 똑같이 다룬다.
+ * 그중 한 페이지를 내보내면 pml4_clear_page()가 큰 페이지를 4 KiB 매핑들로 나눈다.
+ */
+static bool vm_claim_huge(struct page *page, bool *handled)
+{
+	struct thread *curr = thread_current();
+	uint8_t *base = (uint8_t *)((uint64_t)page->va & ~HPGMASK);
+	struct list frames;
+	struct list_elem *e;
+	uint8_t *kbase;
+	bool succ = true;
+	size_t i;
+
+	*handled = false;
+	if (!thp_eligible(curr, base, page->writable))
+		return false;
+
+	// 아직 접근하지 않은 페이지들을 만든다. 실패해도 만든 페이지는 그대로 두면 4 KiB 폴트가 쓴다.
+	for (i = 0; i < HPAGE_PAGES; i++)
+	{
+		void *va = base + i * PGSIZE;
+
+		if (spt_find_page(&curr->spt, va) == NULL && spt_populate(&curr->spt, va) == NULL)
+			return false;
+	}
+
+	kbase = palloc_get_aligned(PAL_USER, HPAGE_PAGES);
+	if (kbase == NULL)
+	{
+		thp_fallback_cnt++;
+		return false;
+	}
+
+	list_init(&frames);
+	for (i = 0; i < HPAGE_PAGES; i++)
+	{
+		struct frame *frame = kmem_cache_alloc(&frame_cache);
+		if (frame == NULL)
+			goto fail;
+		frame->kva = kbase + i * PGSIZE;
+		frame->page = NULL;
+		list_init(&frame->rmap);
+		frame->pinned = true;
+		frame->ref_cnt = 0;
+		list_push_back(&frames, &frame->frame_elem);
+	}
+	if (!pml4_set_huge_page(curr->pml4, base, kbase, page->writable))
+		goto fail;
+
+	i = 0;
+	lock_acquire(&frame_table_lock);
+	for (e = list_begin(&frames); e != list_end(&frames); e = list_next(e), i++)
+		frame_map(list_entry(e, struct frame, frame_elem), spt_find_page(&curr->spt, base + i * PGSIZE));
+	while (!list_empty(&frames))
+		list_push_back(&frame_table, list_pop_front(&frames));
+	lock_release(&frame_table_lock);
+
+	thp_fault_cnt++;
+	*handled = true;
+	for (i = 0; i < HPAGE_PAGES; i++)
+	{
+		struct page *p = spt_find_page(&curr->spt, base + i * PGSIZE);
+		succ = swap_in(p, p->frame->kva) && succ;
+		frame_unpin(p->frame);
+	}
+	return succ;
+
+fail:
+	while (!list_empty(&frames))
+		kmem_cache_free(&frame_cache, list_entry(list_pop_front(&frames), struct frame, frame_elem));
+	for (i = 0; i < HPAGE_PAGES; i++)
+		palloc_free_page(kbase + i * PGSIZE);
+	thp_fallback_cnt++;
+	return false;
+}
+
+/* vm_print_stats - -o thp가 켜져 있다면 큰 페이지 통계를, copy-on-write와 교체, 스왑, 회수가 있었다면 그 통계를 출력한다.
+ */
+void vm_print_stats(void)
+{
+	if (thp_enabled)
+		printf("THP: %llu huge page faults, %llu fallbacks\n",
+			   (unsigned long long)thp_fault_cnt, (unsigned long long)thp_fallback_cnt);
+	if (cow_share_cnt > 0)
+		printf("COW: %llu pages shared at fork, %llu copied on write\n",
+			   (unsigned long long)cow_share_cnt, (unsigned long long)cow_copy_cnt);
+	if (clock_scan_cnt > 0)
+		printf("Clock: %llu frames scanned, %llu reference bits cleared, %llu clean evictions, %llu dirty writebacks\n",
+			   (unsigned long long)clock_scan_cnt, (unsigned long long)clock_clear_cnt,
+			   (unsigned long long)clean_evict_cnt, (unsigned long long)dirty_evict_cnt);
+	anon_print_stats();
+	if (kswapd_reclaim_cnt > 0 || direct_reclaim_cnt > 0)
+		printf("Reclaim: %llu frames by kswapd, %llu by direct reclaim (watermarks %zu/%zu)\n",
+			   (unsigned long long)kswapd_reclaim_cnt, (unsigned long long)direct_reclaim_cnt,
+			   kswapd_low, kswapd_high);
 }
 
 /* Initialize new supplemental page table */
@@ -392,6 +882,45 @@ vm_do_claim_page(struct page *page)
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
 {
 	hash_init(&spt->hash_table, page_hash, page_less, NULL);
+	vma_tree_init(&spt->vmas);
+}
+
+/* cow_share - 부모 페이지 src가 올라가 있는 프레임을 자식 페이지 dst와 읽기 전용으로 공유한다.
+ * 부모와 자식 양쪽을 쓰기 보호로 매핑하므로, 먼저 쓰는 쪽이 vm_handle_wp()에서 복사한다.
+ * src가 스왑으로 나가 있다면 자식 페이지도 같은 스왑 슬롯을 가리키게 한다.
+ */
+static bool cow_share(struct page *dst, struct page *src)
+{
+	struct thread *curr = thread_current();
+	struct frame *frame;
+	bool succ;
+
+	// uninit 상태인 dst를 익명 페이지로 바꾼다. 익명 페이지의 초기화는 프레임 내용을 건드리지 않는다.
+	if (dst == NULL || !swap_in(dst, NULL))
+		return false;
+
+	lock_acquire(&frame_table_lock);
+	while (src->frame != NULL && src->frame->pinned)
+		cond_wait(&frame_unpinned, &frame_table_lock);
+	frame = src->frame;
+	if (frame != NULL)
+	{
+		// 양쪽 매핑을 바꾸는 동안 내보내지지 않도록 잡아 둔다.
+		frame_map(frame, dst);
+		frame->pinned = true;
+	}
+	lock_release(&frame_table_lock);
+
+	if (frame != NULL)
+	{
+		cow_share_cnt++;
+		succ = pml4_set_page(curr->pml4, dst->va, frame->kva, false) && pml4_set_page(src->pml4, src->va, frame->kva, false);
+		frame_unpin(frame);
+		return succ;
+	}
+
+	// 스왑에 있는 페이지는 읽지 않고 같은 스왑 슬롯을 가리킨다. 각자 처음 접근할 때 따로 읽어 온다.
+	return anon_swap_share(dst, src);
 }
 
 /* Copy supplemental page table from src to dst */
@@ -403,6 +932,11 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 {
 
 	struct hash_iterator i;
+
+	// 아직 접근하지 않은 페이지는 영역만 물려주면 자식이 처음 접근할 때 만든다.
+	if (!vma_copy(&dst->vmas, &src->vmas))
+		return false;
+
 	hash_first(&i, &src->hash_table);
 
 	while (hash_next(&i))
@@ -447,9 +981,17 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 		// 	pml4_set_page(thread_current()->pml4, file_page->va, src_page->frame->kva, src_page->writable);
 		// 	continue;
 		// }
+		/* 2) 올라온 적이 있는 익명 페이지는 복사하지 않고 프레임을 공유한다. */
+		else if (vm_type == VM_ANON)
+		{
+			if (!vm_alloc_page(vm_type, va, writable))
+				return false;
+			if (!cow_share(spt_find_page(dst, va), src_page))
+				return false;
+		}
 		else{
 
-			/* 2) type이 uninit이 아니면 */
+			/* 3) 그 밖의 페이지는 바로 복사한다. */
 			if (!vm_alloc_page(vm_type, va, writable)) // uninit page 생성 & 초기화
 				// init이랑 aux는 Lazy Loading에 필요함
 				// 지금 만드는 페이지는 기다리지 않고 바로 내용을 넣어줄 것이므로 필요 없음
@@ -459,9 +1001,13 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 			if (!vm_claim_page(va))
 				return false;
 
+			// 부모의 프레임이 내보내졌다면 내용은 이미 파일에 기록되어 있어 vm_claim_page()가 읽어 왔다.
+			if (src_page->frame == NULL)
+				continue;
+
 			// 매핑된 프레임에 내용 로딩
 			struct page *dst_page = spt_find_page(dst, va);
-			memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
+			copy_page(dst_page->frame->kva, src_page->frame->kva);
 		}
 		
 	}
@@ -478,6 +1024,36 @@ void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED)
 	/* 스레드에 의해 보유된 모든 보조 페이지 테이블을 파괴하고
 	 * 변경된 모든 내용을 저장소에 기록하세요. */
 
+	/* 이 프로세스의 프레임을 frame_table에서 뺀다. 내보내는 중인 프레임은 끝날 때까지 기다린다.
+	   물리 페이지는 pml4_destroy()가 해제한다. */
+	struct hash_iterator i;
+	hash_first(&i, &spt->hash_table);
+	lock_acquire(&frame_table_lock);
+	while (hash_next(&i))
+	{
+		struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
+
+		while (page->frame != NULL && page->frame->pinned)
+			cond_wait(&frame_unpinned, &frame_table_lock);
+		if (page->frame != NULL && page->frame->ref_cnt > 1)
+		{
+			// 다른 프로세스와 공유하는 프레임은 몫만 돌려준다. pml4_destroy()가 해제하지 않도록 매핑도 끊는다.
+			pml4_clear_page(thread_current()->pml4, page->va);
+			frame_put(page->frame, page);
+		}
+		else if (page->frame != NULL)
+		{
+			// munmap으로 매핑만 풀린 프레임은 pml4_destroy()가 모르므로 여기서 해제한다.
+			if (pml4_get_page(thread_current()->pml4, page->va) == NULL)
+				palloc_free_page(page->frame->kva);
+			frame_unlink(page->frame);
+			kmem_cache_free(&frame_cache, page->frame);
+			page->frame = NULL;
+		}
+	}
+	lock_release(&frame_table_lock);
+
 	hash_clear(&spt->hash_table, page_destroy);
 	// hash_destroy(&spt->hash_table, page_destroy);
+	vma_tree_destroy(&spt->vmas);
 }
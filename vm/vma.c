@@ -0,0 +1,305 @@
+/* vma.c: 프로세스 가상 주소 공간의 영역(VMA) 트리. */
+
+#include "vm/vm.h"
+#include <debug.h>
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+/* 영역들은 서로 겹치지 않으므로 구간 트리는 시작 주소를 키로 하는 이진 탐색 트리로 충분하다.
+ * 주소 va를 담는 영역은 start가 va 이하인 영역 중 start가 가장 큰 영역이며, 그 end가 va보다 커야 한다.
+ * 트리는 AVL 트리로 균형을 맞춘다. 폴트는 같은 영역에서 연달아 나는 일이 많으므로
+ * 마지막으로 찾은 영역을 hint에 두고 먼저 확인한다. */
+
+static struct kmem_cache vma_cache;
+
+static struct vm_area *vma_floor (struct vm_area *, const void *va);
+static struct vm_area *vma_ceil (struct vm_area *, const void *va);
+static struct vm_area *vma_insert (struct vm_area *root, struct vm_area *vma);
+static struct vm_area *vma_erase (struct vm_area *root, struct vm_area *vma);
+static void vma_free_all (struct vm_area *);
+
+/* vma_init - 영역을 위한 슬랩 캐시를 만든다. vm_init()에서 호출된다.
+ */
+void vma_init(void)
+{
+	kmem_cache_create(&vma_cache, "vm_area", sizeof(struct vm_area), NULL);
+}
+
+/* vma_tree_init - tree를 빈 트리로 초기화한다.
+ */
+void vma_tree_init(struct vma_tree *tree)
+{
+	tree->root = NULL;
+	tree->hint = NULL;
+	tree->cnt = 0;
+}
+
+/* vma_create - [start, end) 영역을 만들어 tree에 넣고 반환한다.
+ * 페이지 정렬된 영역이어야 하며, 다른 영역과 겹치거나 메모리가 없다면 NULL을 반환한다.
+ * 영역 안의 페이지는 file의 ofs부터 read_bytes 바이트를 읽고 나머지를 0으로 채운 내용이 된다.
+ */
+struct vm_area *vma_create(struct vma_tree *tree, void *start, void *end,
+						   enum vm_type type, bool writable, vm_initializer *init,
+						   struct file *file, off_t ofs, size_t read_bytes)
+{
+	struct vm_area *vma;
+
+	ASSERT(pg_ofs(start) == 0 && pg_ofs(end) == 0);
+	ASSERT(start < end);
+
+	if (vma_overlaps(tree, start, end))
+		return NULL;
+	vma = kmem_cache_alloc(&vma_cache);
+	if (vma == NULL)
+		return NULL;
+
+	vma->start = start;
+	vma->end = end;
+	vma->type = type;
+	vma->writable = writable;
+	vma->init = init;
+	vma->file = file;
+	vma->ofs = ofs;
+	vma->read_bytes = read_bytes;
+	vma->left = vma->right = NULL;
+	vma->height = 1;
+
+	tree->root = vma_insert(tree->root, vma);
+	tree->cnt++;
+	return vma;
+}
+
+/* vma_find - va를 담는 영역을 반환한다. 없다면 NULL을 반환한다.
+ * 할당하지 않으며, 찾은 영역은 다음 탐색을 위해 hint에 남긴다.
+ */
+struct vm_area *vma_find(struct vma_tree *tree, const void *va)
+{
+	struct vm_area *vma = tree->hint;
+
+	if (vma != NULL && vma->start <= va && va < vma->end)
+		return vma;
+
+	vma = vma_floor(tree->root, va);
+	if (vma == NULL || va >= vma->end)
+		return NULL;
+	tree->hint = vma;
+	return vma;
+}
+
+/* vma_overlaps - [start, end)와 겹치는 영역이 있다면 true를 반환한다.
+ * 영역들은 겹치지 않으므로 start가 end보다 작은 영역 중 마지막 영역의 end만 보면 된다.
+ */
+bool vma_overlaps(struct vma_tree *tree, const void *start, const void *end)
+{
+	struct vm_area *vma;
+
+	if (start >= end)
+		return false;
+	vma = vma_floor(tree->root, (const uint8_t *)end - 1);
+	return vma != NULL && vma->end > start;
+}
+
+/* vma_grow_down - vma의 시작을 start까지 아래로 늘린다. 스택처럼 아래로 자라는 영역에 쓴다.
+ * 늘어난 부분이 다른 영역과 겹친다면 아무것도 바꾸지 않고 false를 반환한다.
+ * 늘어난 부분은 바로 앞 영역과 겹치지 않으므로 트리에서의 순서는 그대로이다.
+ */
+bool vma_grow_down(struct vma_tree *tree, struct vm_area *vma, void *start)
+{
+	ASSERT(pg_ofs(start) == 0);
+
+	if (start >= vma->start)
+		return true;
+	if (vma_overlaps(tree, start, vma->start))
+		return false;
+	vma->start = start;
+	return true;
+}
+
+/* vma_remove - vma를 tree에서 빼고 해제한다. 영역의 페이지들은 호출자가 정리한다.
+ */
+void vma_remove(struct vma_tree *tree, struct vm_area *vma)
+{
+	tree->root = vma_erase(tree->root, vma);
+	if (tree->hint == vma)
+		tree->hint = NULL;
+	tree->cnt--;
+	kmem_cache_free(&vma_cache, vma);
+}
+
+/* vma_copy - src의 모든 영역을 빈 트리 dst에 복사한다. fork에서 부모의 주소 공간을 물려줄 때 쓴다.
+ * 파일은 부모와 함께 쓴다. 메모리가 없다면 false를 반환한다.
+ */
+bool vma_copy(struct vma_tree *dst, struct vma_tree *src)
+{
+	struct vm_area *vma;
+
+	// 시작 주소 순서로 다음 영역을 찾아 가며 넣는다.
+	for (vma = vma_ceil(src->root, NULL); vma != NULL; vma = vma_ceil(src->root, vma->end))
+		if (vma_create(dst, vma->start, vma->end, vma->type, vma->writable, vma->init,
+					   vma->file, vma->ofs, vma->read_bytes) == NULL)
+			return false;
+	return true;
+}
+
+/* vma_tree_destroy - tree의 모든 영역을 해제하고 tree를 빈 트리로 되돌린다.
+ */
+void vma_tree_destroy(struct vma_tree *tree)
+{
+	vma_free_all(tree->root);
+	vma_tree_init(tree);
+}
+
+/* vma_floor - root 아래에서 start가 va 이하인 영역 중 start가 가장 큰 영역을 반환한다.
+ */
+static struct vm_area *vma_floor(struct vm_area *v, const void *va)
+{
+	struct vm_area *best = NULL;
+
+	while (v != NULL)
+	{
+		if (v->start <= va)
+		{
+			best = v;
+			v = v->right;
+		}
+		else
+			v = v->left;
+	}
+	return best;
+}
+
+/* vma_ceil - root 아래에서 start가 va 이상인 영역 중 start가 가장 작은 영역을 반환한다.
+ */
+static struct vm_area *vma_ceil(struct vm_area *v, const void *va)
+{
+	struct vm_area *best = NULL;
+
+	while (v != NULL)
+	{
+		if (v->start >= va)
+		{
+			best = v;
+			v = v->left;
+		}
+		else
+			v = v->right;
+	}
+	return best;
+}
+
+/* vma_height - 부분 트리 v의 높이. 빈 트리는 0이다. */
+static int vma_height(struct vm_area *v)
+{
+	return v != NULL ? v->height : 0;
+}
+
+/* vma_update - 자식들의 높이로 v의 높이를 다시 계산한다. */
+static void vma_update(struct vm_area *v)
+{
+	int l = vma_height(v->left), r = vma_height(v->right);
+
+	v->height = (l > r ? l : r) + 1;
+}
+
+/* vma_rotate_right - v의 왼쪽 자식을 부분 트리의 뿌리로 올리고 새 뿌리를 반환한다. */
+static struct vm_area *vma_rotate_right(struct vm_area *v)
+{
+	struct vm_area *l = v->left;
+
+	v->left = l->right;
+	l->right = v;
+	vma_update(v);
+	vma_update(l);
+	return l;
+}
+
+/* vma_rotate_left - v의 오른쪽 자식을 부분 트리의 뿌리로 올리고 새 뿌리를 반환한다. */
+static struct vm_area *vma_rotate_left(struct vm_area *v)
+{
+	struct vm_area *r = v->right;
+
+	v->right = r->left;
+	r->left = v;
+	vma_update(v);
+	vma_update(r);
+	return r;
+}
+
+/* vma_rebalance - 양쪽 높이 차가 1을 넘는 부분 트리 v를 회전으로 맞추고 새 뿌리를 반환한다. */
+static struct vm_area *vma_rebalance(struct vm_area *v)
+{
+	int balance;
+
+	vma_update(v);
+	balance = vma_height(v->left) - vma_height(v->right);
+	if (balance > 1)
+	{
+		if (vma_height(v->left->left) < vma_height(v->left->right))
+			v->left = vma_rotate_left(v->left);
+		return vma_rotate_right(v);
+	}
+	if (balance < -1)
+	{
+		if (vma_height(v->right->right) < vma_height(v->right->left))
+			v->right = vma_rotate_right(v->right);
+		return vma_rotate_left(v);
+	}
+	return v;
+}
+
+/* vma_insert - root 아래에 vma를 넣고 새 뿌리를 반환한다. 트리의 높이는 O(log n)이므로 재귀해도 된다. */
+static struct vm_area *vma_insert(struct vm_area *root, struct vm_area *vma)
+{
+	if (root == NULL)
+		return vma;
+	if (vma->start < root->start)
+		root->left = vma_insert(root->left, vma);
+	else
+		root->right = vma_insert(root->right, vma);
+	return vma_rebalance(root);
+}
+
+/* vma_erase_min - root 아래에서 start가 가장 작은 영역을 떼어 *min에 두고 새 뿌리를 반환한다. */
+static struct vm_area *vma_erase_min(struct vm_area *root, struct vm_area **min)
+{
+	if (root->left == NULL)
+	{
+		*min = root;
+		return root->right;
+	}
+	root->left = vma_erase_min(root->left, min);
+	return vma_rebalance(root);
+}
+
+/* vma_erase - root 아래에서 vma를 떼어 내고 새 뿌리를 반환한다. */
+static struct vm_area *vma_erase(struct vm_area *root, struct vm_area *vma)
+{
+	ASSERT(root != NULL);
+
+	if (vma->start < root->start)
+		root->left = vma_erase(root->left, vma);
+	else if (vma->start > root->start)
+		root->right = vma_erase(root->right, vma);
+	else
+	{
+		struct vm_area *l = root->left, *r = root->right, *min;
+
+		if (r == NULL)
+			return l;
+		r = vma_erase_min(r, &min);
+		min->left = l;
+		min->right = r;
+		root = min;
+	}
+	return vma_rebalance(root);
+}
+
+/* vma_free_all - 부분 트리 v의 모든 영역을 해제한다. */
+static void vma_free_all(struct vm_area *v)
+{
+	if (v == NULL)
+		return;
+	vma_free_all(v->left);
+	vma_free_all(v->right);
+	kmem_cache_free(&vma_cache, v);
+}